@@ -0,0 +1,95 @@
+/*
+* A genetic algorithm for fair land allocation
+* Copyright (c) 2017 Alex Gliesch, Marcus Ritt, Mayron C. O. Moreira
+*
+* Permission is hereby granted, free of charge, to any person (the "Person")
+* obtaining a copy of this software and associated documentation files (the
+* "Software"), to deal in the Software, including the rights to use, copy, modify,
+* merge, publish, distribute the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* 1. The above copyright notice and this permission notice shall be included in
+*    all copies or substantial portions of the Software.
+* 2. Under no circumstances shall the Person be permitted, allowed or authorized
+*    to commercially exploit the Software.
+* 3. Changes made to the original Software shall be labeled, demarcated or
+*    otherwise identified and attributed to the Person.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+* FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+* COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+* IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+* CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+// Times a breadth-first search over all land cells of an instance, once with
+// the neighbours in one vector per cell, as they were stored before, and once
+// with the compressed adjacency of the instance. Build with `make bench`, run
+// as `bench/bfs --in <instance>`.
+#include "../parameters.h"
+#include "../proterra.h"
+#include "../timer.h"
+#include "../util.h"
+
+namespace {
+const int repetitions = 20;
+
+// Visits every land cell, starting a new search at each cell not reached yet,
+// and returns the sum of the distances, so that the work is not optimized out.
+template <typename graph> ll bfs(const graph& g, int nland, vi& dist, vi& q) {
+  dist.assign(nland, -1);
+  ll sum = 0;
+  for (int s = 0; s < nland; ++s) {
+    if (dist[s] != -1) continue;
+    dist[s] = 0;
+    q.clear();
+    q.push_back(s);
+    for (size_t h = 0; h < q.size(); ++h) {
+      int c = q[h];
+      sum += dist[c];
+      for (int nb : g[c])
+        if (dist[nb] == -1) {
+          dist[nb] = dist[c] + 1;
+          q.push_back(nb);
+        }
+    }
+  }
+  return sum;
+}
+
+// Milliseconds per search, the best of all repetitions.
+template <typename graph> double time_bfs(const graph& g, int nland, ll& sum) {
+  vi dist, q;
+  q.reserve(nland);
+  double best = 1e30;
+  for (int i = 0; i < repetitions; ++i) {
+    timer<> t;
+    sum = bfs(g, nland, dist, q);
+    best = min(best, t.milli());
+  }
+  return best;
+}
+} // namespace
+
+int main(int argc, char** argv) {
+  prm::parse_cmd_line(argc, argv);
+  try {
+    instance inst(prm::input_filename);
+    vvi nested(inst.nland);
+    for (int c = 0; c < inst.nland; ++c)
+      for (int nb : inst.neighbours[c]) nested[c].push_back(nb);
+
+    ll sum_nested, sum_csr;
+    double t_nested = time_bfs(nested, inst.nland, sum_nested);
+    double t_csr = time_bfs(inst.neighbours, inst.nland, sum_csr);
+    if (sum_nested != sum_csr)
+      throw runtime_error("the two layouts give different searches");
+    pr("{} cells, best of {}: vvi {:.2f} ms  csr {:.2f} ms  {:.1f}x\n",
+       inst.nland, repetitions, t_nested, t_csr, t_nested / t_csr);
+  } catch (std::exception& e) {
+    pr("\nexception: {}\n", e.what());
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}
@@ -26,108 +26,389 @@
 #include "random.h"
 #include "statistics.h"
 #include "util.h"
+#include <algorithm>
+#include <atomic>
 #include <cassert>
+#include <cmath>
+#include <condition_variable>
 #include <functional>
+#include <mutex>
+#include <numeric>
+#include <thread>
 
 Constructive cons;
 
+namespace {
+// Threads that help to score the queues of a construction step. A step scores
+// only some hundred queues, so the threads are started once and kept: between
+// steps a worker spins for a while, then sleeps until the next step.
+struct score_pool {
+  ~score_pool() {
+    {
+      lock_guard<mutex> l(m);
+      quit = true;
+    }
+    wake.notify_all();
+    for (auto& w : workers) w.join();
+  }
+
+  // Calls f(begin, end) for `parts` consecutive ranges of [0, n), the first on
+  // the calling thread, and returns when all calls are done. Uses parts - 1
+  // workers of at most max_workers.
+  void run(int parts, size_t n, int max_workers,
+           const function<void(size_t, size_t)>& f) {
+    while ((int)workers.size() < max_workers) {
+      int t = workers.size() + 1;
+      workers.emplace_back([this, t] { work(t); });
+    }
+    assert(parts <= (int)workers.size() + 1);
+    job = &f;
+    size = n;
+    num_parts = parts;
+    busy = workers.size();
+    {
+      lock_guard<mutex> l(m);
+      ++round;
+    }
+    wake.notify_all();
+    f(0, n / parts);
+    while (busy != 0) this_thread::yield();
+  }
+
+private:
+  // Every worker takes part in every round, with an empty range if t >= parts,
+  // so no round starts before all workers have seen the last one.
+  void work(int t) {
+    int seen = 0;
+    while (true) {
+      for (int spins = 0; round == seen and not quit; ++spins)
+        if (spins < (1 << 14))
+          this_thread::yield();
+        else {
+          unique_lock<mutex> l(m);
+          wake.wait(l, [&] { return round != seen or quit; });
+        }
+      if (quit) return;
+      seen = round;
+      if (t < num_parts)
+        (*job)(size * t / num_parts, size * (t + 1) / num_parts);
+      --busy;
+    }
+  }
+
+  vector<thread> workers;
+  mutex m;
+  condition_variable wake;
+  atomic<int> round{0}, busy{0};
+  atomic<bool> quit{false};
+  const function<void(size_t, size_t)>* job = nullptr;
+  size_t size = 0;
+  int num_parts = 1;
+};
+
+score_pool scorers;
+} // namespace
+
 void Constructive::construct_from_seeds(solution& s, const vi& initial_pos,
                                         bool use_alpha /*= false*/) {
+  const instance& inst = *s.inst;
 #ifdef HARD_DEBUG
-  assert((int)initial_pos.size() == pt::lots);
-  for (int i = 0; i < pt::lots; ++i)
-    for (int j = 0; j < pt::lots; ++j)
+  assert((int)initial_pos.size() == inst.lots);
+  for (int i = 0; i < inst.lots; ++i)
+    for (int j = 0; j < inst.lots; ++j)
       assert(i == j or initial_pos[i] != initial_pos[j]);
 #endif
   static vector<candidate> initial_cands;
   initial_cands.clear();
-  for (int i = 0; i < pt::lots; ++i)
+  for (int i = 0; i < inst.lots; ++i)
     initial_cands.emplace_back(i, initial_pos[i]);
   s.do_swaps(initial_cands);
   construct(s, use_alpha);
 }
 
+// Candidates that share a lot, the river access of the cell and its aptitude
+// class have the same score, so the frontier keeps them in one queue. Each step
+// scores the first cell of every non-empty queue and takes cells from the best
+// queues, through a heap, until the batch is full: its cost depends on the
+// number of queues, not on the size of the frontier. Cells that were assigned
+// in the meantime are dropped when they reach the front of a queue. As when the
+// frontier was one sorted array, the batch size counts such entries too: each
+// takes the place of a candidate in a later batch.
+//
+// A frontier of at most one window of candidates is not scored: it is kept as a
+// stack, and each step takes the newest batch_size entries.
+double Constructive::batch_scale = 1;
+
 void Constructive::construct(solution& s, bool use_alpha /*= false*/) {
   assert(prm::batch_size >= 1);
-  static vector<candidate> cands;
-  cands.clear();
+  const instance& inst = *s.inst;
+  const int num_classes = inst.apt_values.size();
+  const int alpha = use_alpha ? prm::mutation_greedy_alpha : 1.0;
+  const int todo = inst.nland - s.num_assigned;
+  int bs = prm::batch_size, window = bs * alpha;
+  static fifo_pool buckets;
+  static vi active, queued;
+  static vb is_active;
+  static vbyte in_frontier;
+  static vector<pair<score, int>> heap;
+  static vector<candidate> picked, newest;
+  buckets.reset(inst.lots * 2 * num_classes);
+  is_active.assign(buckets.size(), false);
+  active.clear();
+  newest.clear();
+  queued.assign(inst.nland, 0);
+  assert(prm::neighborhood_size <= 8);
+  in_frontier.assign(inst.nland, 0);
+
+  // pending counts the entries in the queues and stale those of assigned cells;
+  // owed counts the stale entries that have not yet taken a place in a batch.
+  int pending = 0, stale = 0, owed = 0;
+  bool small = false;
+  auto queue = [&](int lot, int c) {
+    if (small) {
+      newest.emplace_back(lot, c);
+      return;
+    }
+    int id = (lot * 2 + inst.nx_river[c]) * num_classes + inst.apt_class[c];
+    buckets[id].push(c);
+    ++pending;
+    ++queued[c];
+    if (not is_active[id]) {
+      is_active[id] = true;
+      active.push_back(id);
+    }
+  };
+  // A cell enters the frontier once per lot: bit k of in_frontier[c] is set
+  // when c is queued for the lot of its k-th neighbour. A pair leaves the
+  // frontier only when its cell is assigned, so the bit is never cleared.
+  auto push = [&](int lot, int c) {
+    int k = 0, slot = -1;
+    for (int nb : inst.neighbours[c]) {
+      if (s.assigned[nb] == lot) {
+        if (in_frontier[c] >> k & 1) return;
+        if (slot == -1) slot = k;
+      }
+      ++k;
+    }
+    assert(slot != -1);
+    in_frontier[c] |= 1 << slot;
+    queue(lot, c);
+  };
+  auto worse = [](const pair<score, int>& a, const pair<score, int>& b) {
+    return b.ff < a.ff;
+  };
+  // Scores the first cell of the queue of each heap entry. Scoring only reads
+  // the solution, so with enough queues the entries are split among threads.
+  auto score_fronts = [&]() {
+    auto run = [&](size_t begin, size_t end) {
+      for (size_t i = begin; i < end; ++i) {
+        int id = heap[i].ss;
+        heap[i].ff = evaluate(s, id / (2 * num_classes), buckets[id].front());
+      }
+    };
+    int threads = max(1, min<int>(prm::construct_threads, heap.size() / 32));
+#ifdef HARD_DEBUG
+    // evaluate checks its result by changing the solution.
+    threads = 1;
+#endif
+    if (threads == 1) {
+      run(0, heap.size());
+      return;
+    }
+    scorers.run(threads, heap.size(), prm::construct_threads - 1,
+                [&run](size_t begin, size_t end) { run(begin, end); });
+  };
+  // Stacks the queues from the worst to the best, so that the best candidates
+  // are the newest.
+  auto to_stack = [&]() {
+    heap.clear();
+    for (int id : active) {
+      auto b = buckets[id];
+      while (b.size() and s.is_assigned(b.front())) {
+        --queued[b.front()];
+        b.pop();
+      }
+      if (b.size()) heap.emplace_back(score(), id);
+    }
+    score_fronts();
+    sort(heap.begin(), heap.end(), worse);
+    newest.assign(owed, candidate());
+    for (auto& h : heap) {
+      auto b = buckets[h.ss];
+      for (; b.size(); b.pop()) {
+        --queued[b.front()];
+        if (not s.is_assigned(b.front()))
+          newest.emplace_back(h.ss / (2 * num_classes), b.front());
+      }
+    }
+    for (int id : active) {
+      buckets[id].clear();
+      is_active[id] = false;
+    }
+    active.clear();
+    pending = stale = owed = 0;
+    small = true;
+  };
+  auto to_buckets = [&]() {
+    small = false;
+    for (auto& c : newest)
+      if (c.is_invalid() or s.is_assigned(c.cell))
+        ++owed;
+      else
+        queue(c.lot, c.cell);
+    newest.clear();
+  };
 
-  if (s.num_assigned != pt::nland) {
-    for (int c = 0; c < pt::nland; ++c)
+  if (s.num_assigned != inst.nland) {
+    for (int c = 0; c < inst.nland; ++c)
       if (s.assigned[c] == -1) {
-        for (int nb : pt::neighbours[c])
+        for (int nb : inst.neighbours[c])
           if (s.assigned[nb] != -1) {
-            cands.emplace_back(s.assigned[nb], c);
+            push(s.assigned[nb], c);
             break;
           }
       }
-    assert(cands.size() > 0);
+    assert(pending > 0);
   }
 
-  int iterations = 0, num_assigned = 0;
-  const int bs = prm::batch_size;
-  int cands_avg = 0, max_cand = nl<int>::min(), num_constructions = 0;
-  while (cands.size()) {
-    max_cand = max(max_cand, (int)cands.size());
-    cands_avg += cands.size();
-    ++num_constructions;
-    ++iterations;
-    if (stats::time_limit_exceeded()) exit(EXIT_SUCCESS);
-
-    int last_mult = (use_alpha ? prm::mutation_greedy_alpha : 1.0);
-    int last = max(0, int(cands.size() - bs * last_mult));
-    assert(last >= 0 and last < (int)cands.size());
-    if (last > 0) {
-      nth_element(cands.begin(), cands.begin() + last, cands.end(),
-                  [&](const candidate& c1, const candidate& c2) {
-                    return compare_candidates(c2, c1, s);
-                  });
-#ifdef HARD_DEBUG
-      for (const auto& c : cands)
-        assert(not c.is_invalid());
-#endif
-      if (use_alpha) {
-        int start = cands.size() - bs;
-        for (int a = start; a >= last; --a) {
-          int j = rng.rand_int(a, cands.size() - 1);
-          if (j >= start) swap(cands[j], cands[a]);
+  timer<> t;
+  bool out_of_time = false;
+  while (small ? newest.size() : active.size()) {
+    const int n = small ? newest.size() : pending - stale + owed;
+    const int entries = small ? newest.size() : pending;
+    stats::max_frontier = max(stats::max_frontier, entries);
+    stats::frontier_sum += entries;
+    ++stats::num_construction_steps;
+    if (prm::adaptive_batch or prm::constructions_per_second > 0) {
+      double progress = 1 - (inst.nland - s.num_assigned) / (double)todo;
+      bs = batch_size(progress, small ? 0.0 : stale / (double)pending);
+      window = bs * alpha;
+    }
+    // Out of time, the solution is completed breadth first, as in naive():
+    // every step takes the whole frontier, unscored.
+    if (out_of_time or stats::time_limit_exceeded()) {
+      out_of_time = true;
+      bs = window = nl<int>::max();
+    }
+    if (not small and n <= window) to_stack();
+
+    picked.clear();
+    if (small) {
+      const int rest = max(0, (int)newest.size() - bs);
+      for (int i = rest; i < (int)newest.size(); ++i)
+        if (not newest[i].is_invalid() and not s.is_assigned(newest[i].cell))
+          picked.push_back(newest[i]);
+      newest.resize(rest);
+    } else {
+      heap.clear();
+      int j = 0;
+      for (int id : active) {
+        auto b = buckets[id];
+        for (; b.size() and s.is_assigned(b.front()); b.pop()) {
+          --queued[b.front()];
+          --pending;
+          --stale;
         }
+        if (b.empty()) {
+          is_active[id] = false;
+          continue;
+        }
+        active[j++] = id;
+        heap.emplace_back(score(), id);
       }
-    }
+      active.resize(j);
+      score_fronts();
+      make_heap(heap.begin(), heap.end(), worse);
 
-    static vector<candidate> accepted_cands;
-    accepted_cands.clear();
-    for (int i = max(0, (int)cands.size() - bs); i < (int)cands.size(); ++i) {
-      if (not s.is_assigned(cands[i].cell)) accepted_cands.push_back(cands[i]);
+      // The window holds the owed stale entries first, as placeholders, then
+      // the best candidates; a batch is drawn from it at random if it is
+      // larger.
+      picked.assign(min(owed, window), candidate());
+      while ((int)picked.size() < window and heap.size()) {
+        pop_heap(heap.begin(), heap.end(), worse);
+        int id = heap.back().ss, lot = id / (2 * num_classes);
+        heap.pop_back();
+        auto b = buckets[id];
+        for (; (int)picked.size() < window and b.size(); b.pop()) {
+          int c = b.front();
+          --queued[c];
+          --pending;
+          if (s.is_assigned(c))
+            --stale;
+          else
+            picked.emplace_back(lot, c);
+        }
+      }
+      if ((int)picked.size() > bs) {
+        for (int i = 0; i < bs; ++i)
+          swap(picked[i], picked[rng.rand_int(i, picked.size() - 1)]);
+        for (int i = bs; i < (int)picked.size(); ++i)
+          if (not picked[i].is_invalid()) queue(picked[i].lot, picked[i].cell);
+        picked.resize(bs);
+      }
+      int k = 0;
+      for (auto& c : picked)
+        if (not c.is_invalid()) picked[k++] = c;
+      owed -= (int)picked.size() - k;
+      picked.resize(k);
     }
 
-    cands.resize(max(0, (int)cands.size() - bs));
-    num_assigned += s.do_swaps(accepted_cands);
-    for (auto& c : accepted_cands) {
+    s.do_swaps(picked);
+    for (auto& c : picked) {
       if (c.is_invalid()) continue;
       assert(c.lot != -1);
-      for (int nb : pt::neighbours[c.cell])
-        if (not s.is_assigned(nb)) cands.emplace_back(c.lot, nb);
+      if (not small) {
+        stale += queued[c.cell];
+        owed += queued[c.cell];
+      }
+      for (int nb : inst.neighbours[c.cell])
+        if (not s.is_assigned(nb)) push(c.lot, nb);
     }
+    if (small and (int)newest.size() > window) to_buckets();
   }
-}
 
-bool Constructive::compare_candidates(const candidate& c1, const candidate& c2,
-                                      const solution& s) {
-  assert(not c1.is_invalid() and not c2.is_invalid());
-
-  if (s.is_assigned(c1.cell) and s.is_assigned(c2.cell))
-    return c1.cell < c2.cell;
-  else if (s.is_assigned(c2.cell))
-    return false;
-  else if (s.is_assigned(c1.cell))
-    return true;
-
-  int r = c1.river_value(s) - c2.river_value(s);
-  if (r == 0) {
-    int sr = c1.size_ratio(s) - c2.size_ratio(s);
-    if (sr == 0) return c1.value(s) < c2.value(s);
-    return sr < 0;
+  // The time of a construction is compared to its share of the budget, by the
+  // number of cells it assigned, and the batches are scaled by at most a factor
+  // of two towards the budget. The scale stops where a full batch takes all
+  // cells, so that the scaled batch sizes stay far from overflowing an int.
+  if (prm::constructions_per_second > 0 and todo > 0 and not out_of_time) {
+    double budget = todo / (double)inst.nland / prm::constructions_per_second;
+    double f = sqrt(t.seconds() / budget);
+    batch_scale *= min(2.0, max(0.5, f));
+    batch_scale = min(max(1.0, inst.nland / (double)prm::batch_size),
+                      max(1.0 / prm::batch_size, batch_scale));
   }
-  return r < 0;
+}
+
+int Constructive::batch_size(double progress, double competition) {
+  double b = prm::batch_size;
+  if (prm::adaptive_batch)
+    b = max((double)prm::min_batch_size,
+            b * (1 - progress) * (1 - competition));
+  return max(1, int(b * batch_scale + 0.5));
+}
+
+score Constructive::evaluate(solution& s, int lot, int cell) {
+  assert(not s.is_assigned(cell));
+  rivers_constraint::candidate rc;
+  s.rc.calc_swap(-1, lot, cell, rc, s);
+  ll value = s.of.value_if_added(lot, s.inst->apt_class[cell]);
+#ifdef HARD_DEBUG
+  objective_function::candidate sp;
+  s.of.calc_swap(-1, lot, cell, sp);
+  assert(sp.value == value);
+#endif
+  return {rc.value, size_ratio(s, lot), value};
+}
+
+int Constructive::size_ratio(const solution& s, int lot) {
+  int ba = (s.area[lot] == s.area[s.big_lot()] ? s.area[lot] + 1
+                                               : s.area[s.big_lot()]);
+  int sa = s.area[s.small_lot()];
+  if (lot == s.small_lot() and s.inst->lots > 1 and
+      s.area[s.rc.sa[1]] > s.area[lot])
+    ++sa;
+  if (sa == 0) return numeric_limits<int>::max();
+  int sr = (ba * 1000) / sa;
+  return sr > 1000 * prm::maximum_size_ratio ? sr : 0;
 }
@@ -35,42 +35,20 @@ struct candidate {
 
   bool is_invalid() const { return cell == -1; }
   void set_invalid() { cell = -1; }
+};
 
-  ll value(const solution& s) const {
-    if (of.last_updated < s.num_assigned) {
-      auto& t = const_cast<candidate&>(*this);
-      const_cast<solution&>(s).of.calc_swap(-1, lot, cell, t.of);
-      t.of.last_updated = s.num_assigned;
-    }
-    assert(of.value != -1);
-    return of.value;
-  }
-
-  int river_value(const solution& s) const {
-    if (rc.last_updated < s.num_assigned) {
-      auto& t = const_cast<candidate&>(*this);
-      auto& ss = const_cast<solution&>(s);
-      ss.rc.calc_swap(-1, lot, cell, t.rc, ss);
-      t.rc.last_updated = s.num_assigned;
-    }
-    assert(rc.value != -1);
-    return rc.value;
-  }
+// Rank of a candidate in the constructive; smaller is better. Candidates are
+// ranked by river constraint value, then by size ratio, then by objective
+// value after the assignment. Only unassigned cells are scored.
+struct score {
+  int river, ratio;
+  ll value;
 
-  int size_ratio(const solution& s) const {
-    int ba = (s.area[lot] == s.area[s.big_lot()] ? s.area[lot] + 1
-                                                 : s.area[s.big_lot()]);
-    int sa = s.area[s.small_lot()];
-    if (lot == s.small_lot() and pt::lots > 1 and
-        s.area[s.rc.sa[1]] > s.area[lot])
-      ++sa;
-    if (sa == 0) return numeric_limits<int>::max();
-    int sr = (ba * 1000) / sa;
-    return sr > 1000 * prm::maximum_size_ratio ? sr : 0;
+  bool operator<(const score& o) const {
+    if (river != o.river) return river < o.river;
+    if (ratio != o.ratio) return ratio < o.ratio;
+    return value < o.value;
   }
-
-  objective_function::candidate of;
-  rivers_constraint::candidate rc;
 };
 
 struct Constructive {
@@ -80,6 +58,16 @@ struct Constructive {
 
   static void construct(solution& s, bool use_alpha = false);
 
-  static bool compare_candidates(const candidate& c1, const candidate& c2,
-                                 const solution& s);
+  static score evaluate(solution& s, int lot, int cell);
+
+  // Batch size of the next construction step, when the given fraction of the
+  // cells to assign has been assigned and the given fraction of the frontier
+  // entries is of cells already taken by another lot.
+  static int batch_size(double progress, double competition);
+
+private:
+  static int size_ratio(const solution& s, int lot);
+
+  // Factor applied to all batch sizes by the time budget policy.
+  static double batch_scale;
 };
@@ -32,16 +32,15 @@
 #include <vector>
 
 double recalc_ch_area(int lot, const solution& s) {
+  const instance& inst = *s.inst;
   vector<point> pts;
-  for (int i = 0; i < pt::nland; ++i) {
-    if (s.assigned[i] == lot) {
-      int r = pt::rc_from_index[i].ff, c = pt::rc_from_index[i].ss;
-      pts.emplace_back(r - 1, c - 1);
-      pts.emplace_back(r, c - 1);
-      pts.emplace_back(r - 1, c - 1);
-      pts.emplace_back(r, c);
-    }
-  }
+  s.for_each_cell(lot, [&](int i) {
+    int r = inst.rc_from_index[i].ff, c = inst.rc_from_index[i].ss;
+    pts.emplace_back(r - 1, c - 1);
+    pts.emplace_back(r, c - 1);
+    pts.emplace_back(r - 1, c - 1);
+    pts.emplace_back(r, c);
+  });
   if (pts.size() == 0) return 0;
   pts = convex_hull(pts);
   return polygon_area(pts);
@@ -49,7 +48,7 @@ double recalc_ch_area(int lot, const solution& s) {
 
 double avg_ch_ratio(const solution& s) {
   vd ch_values;
-  for (int i = 0; i < pt::lots; ++i) {
+  for (int i = 0; i < s.inst->lots; ++i) {
     double ch = recalc_ch_area(i, s);
     if (ch and s.area[i]) ch_values.push_back(ch / double(s.area[i]));
   }
@@ -36,6 +36,22 @@ using uint = uint32_t;
 using ull = uint64_t;
 using ll = int64_t;
 using ld = long double;
+
+// The lot of a cell as stored in solutions, -1 if unassigned. Signed, so that
+// -1 compares as usual; build with "make LOT_BITS=8" for up to 127 lots or
+// LOT_BITS=32 for more than 32767.
+#ifndef LOT_BITS
+#define LOT_BITS 16
+#endif
+#if LOT_BITS == 8
+using lot_t = int8_t;
+#elif LOT_BITS == 16
+using lot_t = int16_t;
+#elif LOT_BITS == 32
+using lot_t = int32_t;
+#else
+#error "LOT_BITS must be 8, 16 or 32"
+#endif
 #define ii pair<int, int>
 #define iii tuple<int, int, int>
 #define vii vector<ii>
@@ -48,6 +64,7 @@ using ld = long double;
 #define vll vector<ll>
 #define vvb vector<vb>
 #define vbyte vector<uchar>
+#define vlot vector<lot_t>
 #define uptr unique_ptr
 #define nl numeric_limits
 #define str to_string
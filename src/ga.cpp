@@ -34,7 +34,6 @@
 #include "validate.h"
 #include <algorithm>
 #include <cassert>
-#include <queue>
 #include <tuple>
 
 bool compare_solutions(const uptr<solution>& a, const uptr<solution>& b) {
@@ -60,57 +59,64 @@ void ga::run() {
   pr("\ngenerating initial population...\n");
   for (int i = 0; i < pop_size; ++i) {
     pr("{}{}", i, (i == pop_size - 1 ? "" : ", "));
-    pop[i].reset(new solution());
+    pop[i].reset(new solution(inst));
     pop[i]->init();
-    auto pos = initial_positions::generate_initial_positions();
+    auto pos = initial_positions::generate_initial_positions(inst);
     ++stats::num_new_solutions;
     Constructive::construct_from_seeds(*pop[i], pos);
     if (stats::global_best.num_assigned == 0 or *pop[i] < stats::global_best)
       stats::global_best = *pop[i];
     validate_solution(*pop[i]);
+    if (stats::time_limit_exceeded()) return;
   }
 
+  // Out of time in the middle of a generation: the best of the children built
+  // so far, pop2[0, n), is reported like a generation, so that none is lost.
+  auto report_children = [&](int n) {
+    int best = -1;
+    for (int i = 0; i < n; ++i)
+      if (best == -1 or compare_solutions(pop2[i], pop2[best])) best = i;
+    if (best != -1) stats::add_stats(*pop2[best]);
+  };
+
   pr("\nstarting generations...\n");
   int best_since = 0;
-  auto best_stats =
-      make_tuple(numeric_limits<int>::max(), numeric_limits<double>::max(),
-                 numeric_limits<double>::max());
+  fitness_key best_key = ~fitness_key(0);
+  bool restart = false;
   while (true) {
     int best = 0;
     for (int i = 0; i < pop_size; ++i) {
       if (compare_solutions(pop[i], pop[best])) {
         best = i;
-        auto stats = make_tuple(pop[best]->river_value(),
-                                pop[best]->size_ratio(), pop[best]->value());
-        if (stats < best_stats) {
+        if (pop[best]->key < best_key) {
           best_since = stats::num_generations;
-          best_stats = stats;
+          best_key = pop[best]->key;
           pr("best_since = {}\n", best_since);
         }
       }
-      if (pop2[i] == nullptr) pop2[i].reset(new solution());
+      if (pop2[i] == nullptr) pop2[i].reset(new solution(inst));
     }
 
     pr("\nGENERATION #{}:\n", stats::num_generations);
     stats::add_stats(*pop[best]);
+    if (on_generation) on_generation(restart);
 
     if (stats::time_limit_exceeded() or
         stats::num_generations >= prm::max_generations)
-      exit(EXIT_SUCCESS);
+      return;
     ++stats::num_generations;
 
-    bool restart = prm::restart == -1
-                       ? false
-                       : (stats::num_generations - best_since) >= prm::restart;
+    restart = prm::restart == -1
+                  ? false
+                  : (stats::num_generations - best_since) >= prm::restart;
     if (restart) {
       pr("restarting...\n");
       best_since = stats::num_generations;
       pr("best_since = {}\n", best_since);
-      best_stats =
-          make_tuple(numeric_limits<int>::max(), numeric_limits<double>::max(),
-                     numeric_limits<double>::max());
+      best_key = ~fitness_key(0);
     } else {
       for (int i = 0; i < crossover_size; ++i) {
+        if (stats::time_limit_exceeded()) return report_children(i);
         int p1, p2;
         select_parents_by_tournament(&p1, &p2);
         if (prm::do_crossover) {
@@ -130,17 +136,15 @@ void ga::run() {
     }
     for (int i = restart ? 0 : crossover_size;
          i < (restart ? pop_size : crossover_size + new_size); ++i) {
+      if (stats::time_limit_exceeded()) return report_children(i);
       pop2[i]->init();
       ++stats::num_new_solutions;
       Constructive::construct_from_seeds(
-          *pop2[i], initial_positions::generate_initial_positions());
+          *pop2[i], initial_positions::generate_initial_positions(inst));
       validate_solution(*pop2[i]);
       if (restart) {
-        auto stats = make_tuple(pop2[i]->river_value(), pop2[i]->size_ratio(),
-                                pop2[i]->value());
-        if (stats < best_stats) {
-          best_stats = stats;
-        }
+        if (pop2[i]->key < best_key)
+          best_key = pop2[i]->key;
       }
     }
     if (not restart) {
@@ -157,34 +161,35 @@ void ga::run() {
 void ga::crossover(const solution& p1, const solution& p2, solution& child) {
   static vvi cost;
   static vi lmate, rmate;
-  cost.resize(pt::lots);
-  lmate.resize(pt::lots);
-  rmate.resize(pt::lots);
+  cost.resize(inst.lots);
+  lmate.resize(inst.lots);
+  rmate.resize(inst.lots);
   for (auto& c : cost)
-    c.assign(pt::lots, 0);
+    c.assign(inst.lots, 0);
 
-  for (int c = 0; c < pt::nland; ++c) {
+  for (int c = 0; c < inst.nland; ++c) {
     int lot1 = p1.assigned[c], lot2 = p2.assigned[c];
-    if (lot1 < 0 or lot1 >= pt::lots or lot2 < 0 or lot2 >= pt::lots) {
+    if (lot1 < 0 or lot1 >= inst.lots or lot2 < 0 or lot2 >= inst.lots) {
       pr("lp1: {}, lp2: {}\n", lot1, lot2);
       p1.write_to_png("error_p1.png");
       p2.write_to_png("error_p2.png");
     }
-    assert(lot1 >= 0 and lot1 < pt::lots);
-    assert(lot2 >= 0 and lot2 < pt::lots);
+    assert(lot1 >= 0 and lot1 < inst.lots);
+    assert(lot2 >= 0 and lot2 < inst.lots);
     --cost[lot1][lot2];
   }
 
   min_cost_bipartite_matching(cost, lmate, rmate);
 
-  static vi assigned, cc_num, cc_largest, cc_start;
-  assigned.assign(pt::nland, -1);
-  cc_num.assign(pt::lots, 0);
-  cc_largest.assign(pt::lots, -1);
-  cc_start.assign(pt::lots, -1);
+  static vlot assigned;
+  static vi cc_num, cc_largest, cc_start;
+  assigned.assign(inst.nland, -1);
+  cc_num.assign(inst.lots, 0);
+  cc_largest.assign(inst.lots, -1);
+  cc_start.assign(inst.lots, -1);
 
   auto bfs = [&](int start, int lot_assign, int lotp1, int lotp2) {
-    static queue<int> q;
+    static fifo q;
     assert(q.empty());
     q.push(start);
     assigned[start] = lot_assign;
@@ -192,7 +197,7 @@ void ga::crossover(const solution& p1, const solution& p2, solution& child) {
     while (q.size()) {
       int c = q.front();
       q.pop();
-      for (int nb : pt::neighbours[c])
+      for (int nb : inst.neighbours[c])
         if (p1.assigned[nb] == lotp1 and p2.assigned[nb] == lotp2 and
             assigned[nb] == -1) {
           q.push(nb);
@@ -203,7 +208,7 @@ void ga::crossover(const solution& p1, const solution& p2, solution& child) {
     return size;
   };
 
-  for (int c = 0; c < pt::nland; ++c) {
+  for (int c = 0; c < inst.nland; ++c) {
     int lot1 = p1.assigned[c], lot2 = p2.assigned[c];
     assert(lot1 != -1 and lot2 != -1);
     if (assigned[c] == -1 and lmate[lot1] == lot2) {
@@ -218,9 +223,9 @@ void ga::crossover(const solution& p1, const solution& p2, solution& child) {
   }
 
   int lot_num = 0;
-  assigned.assign(pt::nland, -1);
+  assigned.assign(inst.nland, -1);
 
-  for (int l = 0; l < pt::lots; ++l) {
+  for (int l = 0; l < inst.lots; ++l) {
     if (cc_num[l] > 1) {
       assert(cc_largest[l] > 0);
       ++stats::num_disconnected_crossover_lots;
@@ -234,38 +239,34 @@ void ga::crossover(const solution& p1, const solution& p2, solution& child) {
     }
   }
 
-  if (lot_num != pt::lots) {
+  if (lot_num != inst.lots) {
     ++stats::num_empty_crossover_lots;
-    assert(lot_num < pt::lots);
-    vi empty_lots(pt::lots - lot_num);
+    assert(lot_num < inst.lots);
+    static vi empty_lots;
+    empty_lots.resize(inst.lots - lot_num);
     iota(empty_lots.begin(), empty_lots.end(), lot_num);
     empty_lots_fix(empty_lots, assigned);
   }
-  child.init();
-  swap(assigned, child.assigned);
-  child.populate(move(child.assigned));
+  child.populate(assigned);
   Constructive::construct(child);
 }
 
 void ga::mutation(solution& s) {
-  static vi dist, empty_lots, any, any_seen, assigned_new;
-  vi& assigned = s.assigned;
-  vi& area = s.area;
-  dist.assign(pt::nland, -1);
-  empty_lots.clear();
-  any.assign(pt::lots, -1);
-  any_seen.assign(pt::lots, 0);
-  assigned_new.assign(pt::nland, -1);
+  static vi dist, any, any_seen, erased;
+  static viii changes;
+  const vlot& assigned = s.assigned;
+  const vi& area = s.area;
+  dist.assign(inst.nland, -1);
+  any.assign(inst.lots, -1);
+  any_seen.assign(inst.lots, 0);
+  erased.clear();
 
-  static queue<int> q;
+  static fifo q;
   assert(q.empty());
-  for (int c = 0; c < pt::nland; ++c) {
-    assert(assigned[c] != -1);
-    any[assigned[c]] = c;
-    if (s.check_border_brute_force(c)) {
-      dist[c] = 0;
-      q.push(c);
-    }
+  assert(s.num_assigned == inst.nland);
+  for (int c : s.border()) {
+    dist[c] = 0;
+    q.push(c);
   }
 
   while (q.size()) {
@@ -280,15 +281,18 @@ void ga::mutation(solution& s) {
       continue;
     }
 
-    assigned[c] = -1;
+    // A lot that is erased completely restarts from its last cell.
+    if (any_seen[assigned[c]] == 0) any[assigned[c]] = max(any[assigned[c]], c);
+    s.reassign(changes, c, -1);
+    erased.push_back(c);
     if (dist[c] + 1 < prm::mutation_brush_size) {
-      for (int nb : pt::neighbours[c])
+      for (int nb : inst.neighbours[c])
         if (dist[nb] == -1) {
           dist[nb] = dist[c] + 1;
           q.push(nb);
         }
     } else if (dist[c] + 1 == prm::mutation_brush_size) {
-      for (int nb : pt::neighbours[c])
+      for (int nb : inst.neighbours[c])
         if (assigned[nb] != -1 and dist[nb] == -1) {
           ++any_seen[assigned[nb]];
           if (rng.rand_double(0.0, 1.0) < 1.0 / double(any_seen[assigned[nb]]))
@@ -298,9 +302,14 @@ void ga::mutation(solution& s) {
   }
 
   assert(q.empty());
-  dist.assign(pt::nland, -1);
+  dist.assign(inst.nland, -1);
 
-  for (int i = 0; i < pt::lots; ++i) {
+  // Lots without border cells (e.g. covering a whole island) were not
+  // touched by the brush and also restart from their last cell.
+  for (int i = 0; i < inst.lots; ++i)
+    if (any[i] == -1) s.for_each_cell(i, [&](int c) { any[i] = max(any[i], c); });
+
+  for (int i = 0; i < inst.lots; ++i) {
     assert((any[i] != -1 and any_seen[i] >= 0) or
            (any[i] == -1 and any_seen[i] == 0));
     if (any[i] != -1) {
@@ -312,17 +321,34 @@ void ga::mutation(solution& s) {
   while (q.size()) {
     int c = q.front();
     q.pop();
-    assigned_new[c] = dist[c];
-    for (int nb : pt::neighbours[c])
+    if (assigned[c] != dist[c]) s.reassign(changes, c, dist[c]);
+    for (int nb : inst.neighbours[c])
       if (assigned[nb] != -1 and dist[nb] == -1) {
         dist[nb] = dist[c];
         q.push(nb);
       }
   }
 
-  swap(assigned, assigned_new);
+  // The remaining cells were cut off from the cell their lot restarts from.
+  // Lots are connected, so each such piece touches an erased cell.
+  for (int e : erased)
+    for (int nb : inst.neighbours[e])
+      if (assigned[nb] != -1 and dist[nb] == -1) {
+        dist[nb] = inst.lots;
+        q.push(nb);
+        while (q.size()) {
+          int c = q.front();
+          q.pop();
+          s.reassign(changes, c, -1);
+          for (int nb2 : inst.neighbours[c])
+            if (assigned[nb2] != -1 and dist[nb2] == -1) {
+              dist[nb2] = inst.lots;
+              q.push(nb2);
+            }
+        }
+      }
 
-  s.populate(move(assigned));
+  s.apply_changes(changes);
   Constructive().construct(s, true);
 }
 
@@ -371,15 +397,15 @@ void ga::select_parents_by_tournament(int* p1, int* p2) {
   }
 }
 
-void ga::empty_lots_fix(const vi& empty_lots, vi& assigned) {
+void ga::empty_lots_fix(const vi& empty_lots, vlot& assigned) {
   if (empty_lots.empty()) return;
   static vi chosen;
   chosen.resize(empty_lots.size());
   int j = 0;
-  for (int i = 0; i < pt::nland and j < (int)empty_lots.size(); ++i)
+  for (int i = 0; i < inst.nland and j < (int)empty_lots.size(); ++i)
     if (assigned[i] == -1) chosen[j++] = i;
   assert(j == (int)empty_lots.size());
-  for (int i = chosen.back() + 1; i < pt::nland; ++i) {
+  for (int i = chosen.back() + 1; i < inst.nland; ++i) {
     if (assigned[i] == -1) {
       ++j;
       int k = rng.rand_int(0, j);
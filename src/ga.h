@@ -25,9 +25,14 @@
 #pragma once
 #include "defines.h"
 #include "solution.h"
+#include <functional>
 #include <memory>
 
 struct ga {
+  explicit ga(const instance& inst) : inst(inst) {}
+
+  // Runs until the time limit or the maximum number of generations is reached,
+  // and returns; the best solution found is in stats::global_best.
   void run();
 
   void crossover(const solution& p1, const solution& p2, solution& child);
@@ -36,9 +41,15 @@ struct ga {
 
   void select_parents_by_tournament(int* p1, int* p2);
 
-  void empty_lots_fix(const vi& empty_lots, vi& assigned);
+  void empty_lots_fix(const vi& empty_lots, vlot& assigned);
+
+  const instance& inst;
 
   vector<uptr<solution>> pop, pop2;
+
+  // Called after each generation is reported, with whether its population was
+  // built from scratch by a restart.
+  function<void(bool restarted)> on_generation;
 };
 
 bool compare_solutions(const uptr<solution>& a, const uptr<solution>& b);
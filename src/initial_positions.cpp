@@ -35,22 +35,21 @@
 #include <queue>
 #include <stdexcept>
 #include <tuple>
+#include <unordered_set>
 
-vvi initial_positions::cc;
-vi initial_positions::cc_num_lots;
-
-void save_initial_positions_as_png(const vi& v, string filename) {
-  solution s;
-  s.assigned.assign(pt::nland, -1);
+void save_initial_positions_as_png(const instance& inst, const vi& v,
+                                   string filename) {
+  solution s(inst);
+  s.assigned.assign(inst.nland, -1);
   for (int i = 0; i < (int)v.size(); ++i) {
     int u = v[i], r, c;
-    tie(r, c) = pt::rc_from_index[u];
+    tie(r, c) = inst.rc_from_index[u];
     s.assigned[u] = i;
     int dr[] = {0, 0, 1, -1, 1, 1, -1, -1}, dc[] = {1, -1, 0, 0, 1, -1, 1, -1};
     for (int j = 0; j < 8; ++j) {
       int rr = r + dr[j], cc = c + dc[j];
-      if (rr >= 0 and rr < pt::r_size and cc >= 0 and cc < pt::c_size) {
-        int v = pt::index_from_rc[rr][cc];
+      if (inst.inside_boundaries(rr, cc)) {
+        int v = inst.index_at(rr, cc);
         if (v != -1) s.assigned[v] = i;
       }
     }
@@ -58,70 +57,86 @@ void save_initial_positions_as_png(const vi& v, string filename) {
   s.write_to_png(filename);
 }
 
-vi initial_positions::generate_initial_positions() {
-  vi v = gen_rand_initial_positions();
-  v = k_means_step(v);
+vi initial_positions::generate_initial_positions(const instance& inst) {
+  vi v = gen_rand_initial_positions(inst);
+  v = k_means_step(inst, v);
   return move(v);
 }
 
-vi initial_positions::k_means_step(const vi& v) {
-  const int k = pt::lots;
+vi initial_positions::k_means_step(const instance& inst, const vi& v) {
+  const int k = inst.lots;
   vvi parcel_cells(k);
-  vi assigned = voronoi().construct(v);
-  assert((int)assigned.size() == pt::nland);
-  for (int i = 0; i < pt::nland; ++i)
+  vi assigned = voronoi().construct(inst, v);
+  assert((int)assigned.size() == inst.nland);
+  for (int i = 0; i < inst.nland; ++i)
     if (assigned[i] != -1) parcel_cells[assigned[i]].push_back(i);
   vi ans;
-  vvb centroid(pt::r_size, vb(pt::c_size, false));
+  static vbyte centroid;
+  static vi visited;
+  static int search = 0;
+  static unordered_set<int> visited_sparse;
+  static queue<int> q;
+  centroid.resize(inst.nland, false);
+  if (not inst.sparse_grid) visited.resize(inst.r_size * inst.c_size, 0);
+  auto first_visit = [&](int o) {
+    if (inst.sparse_grid) return visited_sparse.insert(o).second;
+    if (visited[o] == search) return false;
+    visited[o] = search;
+    return true;
+  };
+  auto free_land = [&](int o) {
+    int u = inst.index_at(o / inst.c_size, o % inst.c_size);
+    return u != -1 and not centroid[u];
+  };
+
   for (int i = 0; i < k; ++i) {
     double r = 0, c = 0;
     for (auto j : parcel_cells[i]) {
-      r += pt::rc_from_index[j].ff;
-      c += pt::rc_from_index[j].ss;
+      r += inst.rc_from_index[j].ff;
+      c += inst.rc_from_index[j].ss;
     }
     r = round(r / (double)parcel_cells[i].size());
     c = round(c / (double)parcel_cells[i].size());
-    int ri = r, ci = c;
-    if (pt::cell_type[ri][ci] != pt::land or centroid[ri][ci]) {
-      queue<ii> q;
-      vvb visited(pt::r_size, vb(pt::c_size, false));
-      visited[ri][ci] = true;
-      q.push(ii(ri, ci));
+    int ri = r, ci = c, o = inst.offset(ri, ci);
+    if (not free_land(o)) {
+      ++search;
+      visited_sparse.clear();
+      q = queue<int>();
+      first_visit(o);
+      q.push(o);
       while (q.size()) {
-        ii v = q.front();
+        int v = q.front();
         q.pop();
-        if (pt::cell_type[v.ff][v.ss] == pt::land and
-            not centroid[v.ff][v.ss]) {
-          ri = v.ff;
-          ci = v.ss;
+        if (free_land(v)) {
+          o = v;
           break;
         }
         for (int i = 0; i < 4; ++i) {
-          int nr = v.ff + dr[i], nc = v.ss + dc[i];
-          if (nr < 0 or nr >= pt::r_size or nc < 0 or nc >= pt::c_size)
-            continue;
-          if (not visited[nr][nc]) {
-            visited[nr][nc] = true;
-            q.push(ii(nr, nc));
-          }
+          int nr = v / inst.c_size + dr[i], nc = v % inst.c_size + dc[i];
+          if (not inst.inside_boundaries(nr, nc)) continue;
+          int no = inst.offset(nr, nc);
+          if (first_visit(no)) q.push(no);
         }
       }
     }
-    centroid[ri][ci] = true;
-    ans.push_back(pt::index_from_rc[ri][ci]);
+    int u = inst.index_at(o / inst.c_size, o % inst.c_size);
+    centroid[u] = true;
+    ans.push_back(u);
   }
+  for (int i : ans)
+    centroid[i] = false;
   return move(ans);
 }
 
-vi initial_positions::gen_rand_initial_positions() {
+vi initial_positions::gen_rand_initial_positions(const instance& inst) {
   vi v, u;
-  for (int i = 0; i < (int)cc.size(); ++i) {
-    if (cc_num_lots[i] == 0) continue;
-    choice(cc[i], u, cc_num_lots[i]);
-    assert((int)u.size() == cc_num_lots[i]);
+  for (int i = 0; i < (int)inst.cc.size(); ++i) {
+    if (inst.cc_num_lots[i] == 0) continue;
+    choice(inst.cc[i], u, inst.cc_num_lots[i]);
+    assert((int)u.size() == inst.cc_num_lots[i]);
     for (int i : u)
       v.push_back(i);
   }
-  assert((int)v.size() == pt::lots);
+  assert((int)v.size() == inst.lots);
   return move(v);
 }
@@ -26,14 +26,12 @@
 #include "defines.h"
 #include <vector>
 
-struct initial_positions {
-  static vi generate_initial_positions();
-
-  static vi k_means_step(const vi& v);
+struct instance;
 
-  static vi gen_rand_initial_positions();
+struct initial_positions {
+  static vi generate_initial_positions(const instance& inst);
 
-  static vvi cc;
+  static vi k_means_step(const instance& inst, const vi& v);
 
-  static vi cc_num_lots;
+  static vi gen_rand_initial_positions(const instance& inst);
 };
@@ -28,6 +28,7 @@
 #include "parameters.h"
 #include "proterra.h"
 #include "random.h"
+#include "raster.h"
 #include "statistics.h"
 #include "util.h"
 #include "voronoi.h"
@@ -38,6 +39,9 @@
 
 bool wrote_stats = false;
 
+// Kept outside main so it is still alive when write_stats runs at exit.
+uptr<instance> input;
+
 void write_stats(int) {
   stats::write_stats();
   wrote_stats = true;
@@ -48,16 +52,16 @@ void write_stats_void() {
   if (not wrote_stats) write_stats(0);
 }
 
-solution naive() {
+solution naive(const instance& inst) {
   static vi seeds;
-  static vi assigned;
-  seeds.resize(pt::lots);
-  assigned.assign(pt::nland, -1);
+  static vlot assigned;
+  seeds.resize(inst.lots);
+  assigned.assign(inst.nland, -1);
 
   static queue<int> q;
-  for (int i = 0; i < pt::lots; ++i) {
+  for (int i = 0; i < inst.lots; ++i) {
     while (true) {
-      int r = rng.rand_int(0, pt::nland - 1);
+      int r = rng.rand_int(0, inst.nland - 1);
       if (assigned[r] == -1) {
         seeds[i] = r;
         assigned[r] = i;
@@ -70,7 +74,7 @@ solution naive() {
   while (q.size()) {
     int c = q.front();
     q.pop();
-    for (int nb : pt::neighbours[c]) {
+    for (int nb : inst.neighbours[c]) {
       if (assigned[nb] == -1) {
         assigned[nb] = assigned[c];
         q.push(nb);
@@ -78,33 +82,46 @@ solution naive() {
     }
   }
 
-  solution s;
+  solution s(inst);
   s.populate(assigned);
   return s;
 }
 
 int main(int argc, char** argv) {
   prm::parse_cmd_line(argc, argv);
+  if (prm::convert_output.size()) {
+    try {
+      raster in;
+      in.read(prm::input_filename, prm::parse_threads);
+      if (prm::lots > 0) in.lots = prm::lots;
+      in.write_binary(prm::convert_output);
+    } catch (std::exception& e) {
+      pr("\nexception: {}\n", e.what());
+      return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+  }
   signal(SIGABRT, write_stats);
   signal(SIGTERM, write_stats);
   signal(SIGINT, write_stats);
   atexit(write_stats_void);
 
   try {
-    pt::init();
+    input.reset(new instance(prm::input_filename));
+    stats::init(*input);
     if (prm::solution_input.size()) {
       solution s;
-      pt::read_solution(s, prm::solution_input);
+      input->read_solution(s, prm::solution_input);
       stats::add_stats(s);
     } else if (prm::naive) {
       int repl = 0;
       while (not stats::time_limit_exceeded() and repl < prm::max_generations) {
-        solution s = naive();
+        solution s = naive(*input);
         stats::add_stats(s);
         ++repl;
       }
     } else {
-      ga().run();
+      ga(*input).run();
     }
   } catch (std::exception& e) {
     pr("\nexception: {}\n", e.what());
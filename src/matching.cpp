@@ -23,7 +23,6 @@
 * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 */
 #include "matching.h"
-#include "proterra.h"
 #include <algorithm>
 #include <cassert>
 
@@ -31,9 +30,9 @@
 // https://github.com/jaehyunp/stanfordacm/blob/master/notebook.html
 int min_cost_bipartite_matching(const vvi& cost, vi& Lmate, vi& Rmate) {
   const int n = cost.size();
-  assert(n == pt::lots);
+  assert(n == (int)Lmate.size() and n == (int)Rmate.size());
   static vi u, v, dist, dad, seen;
-  if (u.empty()) {
+  if ((int)u.size() != n) {
     u.resize(n);
     v.resize(n);
     dist.resize(n);
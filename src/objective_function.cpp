@@ -31,13 +31,36 @@
 #include "solution.h"
 #include "util.h"
 
-void objective_function::init() {
-	val.assign(pt::lots, 0);
+void objective_function::init(const instance &inst) {
+	this->inst = &inst;
+	val.assign(inst.lots, 0);
 	value = sum_xi = sum_xi_sq = 0;
+	num_classes = inst.apt_values.size();
+	sq_delta.assign(inst.lots * num_classes, 0);
+	mean_term.assign(num_classes, 0);
+	for (int i = 0; i < inst.lots; ++i)
+		refresh_sq_delta(i);
+	refresh_mean_term();
+}
+
+void objective_function::refresh_sq_delta(int lot) {
+	ll v = val[lot];
+	ll *d = &sq_delta[lot * num_classes];
+	for (int k = 0; k < num_classes; ++k) {
+		ll x = inst->apt_values[k];
+		d[k] = 2 * v * x + x * x;
+	}
+}
+
+void objective_function::refresh_mean_term() {
+	for (int k = 0; k < num_classes; ++k) {
+		ll s = sum_xi + inst->apt_values[k];
+		mean_term[k] = s * s / inst->lots;
+	}
 }
 
 void objective_function::calc_swap(int from, int to, int c, candidate &sp) {
-	int xj = pt::val[c];
+	int xj = inst->val[c];
 	sp.sum_xi = sum_xi;
 	sp.sum_xi_sq = sum_xi_sq;
 	if (from != -1) {
@@ -50,7 +73,7 @@ void objective_function::calc_swap(int from, int to, int c, candidate &sp) {
 		sp.sum_xi_sq += -(vt * vt) + (vt + xj) * (vt + xj);
 		sp.sum_xi += xj;
 	}
-	sp.value = sp.sum_xi_sq - (sp.sum_xi * sp.sum_xi) / pt::lots;
+	sp.value = sp.sum_xi_sq - (sp.sum_xi * sp.sum_xi) / inst->lots;
 #ifdef HARD_DEBUG
 	if (from != -1)
 		val[from] -= xj;
@@ -66,55 +89,86 @@ void objective_function::calc_swap(int from, int to, int c, candidate &sp) {
 }
 
 void objective_function::do_swap(int from, int to, int c, candidate &sp) {
-	if (from != -1)
-		val[from] -= pt::val[c];
-	if (to != -1)
-		val[to] += pt::val[c];
+	if (from != -1) {
+		val[from] -= inst->val[c];
+		refresh_sq_delta(from);
+	}
+	if (to != -1) {
+		val[to] += inst->val[c];
+		refresh_sq_delta(to);
+	}
 	assert(sum_xi != -1);
 	assert(sum_xi_sq != -1);
 	sum_xi = sp.sum_xi;
 	sum_xi_sq = sp.sum_xi_sq;
 	value = sp.value;
+	refresh_mean_term();
 	assert(sum_xi != -1);
 	assert(sum_xi_sq != -1);
 	assert_value_acceptable(sp.value);
 }
 
 void objective_function::do_swaps(vector<::candidate> &cands) {
-	if ((int)cands.size() < pt::lots) {
+	if ((int)cands.size() < inst->lots) {
 		// 	if (false) {
 		for (int i = 0; i < (int)cands.size(); ++i) {
 			if (cands[i].is_invalid())
 				continue;
-			ll xj = pt::val[cands[i].cell];
+			ll xj = inst->val[cands[i].cell];
 			assert(cands[i].lot != -1);
 			ll vt = val[cands[i].lot];
 			sum_xi_sq += -(vt * vt) + (vt + xj) * (vt + xj);
 			sum_xi += xj;
 			val[cands[i].lot] += xj;
+			refresh_sq_delta(cands[i].lot);
 		}
 	} else {
 		for (int i = 0; i < (int)cands.size(); ++i) {
 			if (cands[i].is_invalid())
 				continue;
-			val[cands[i].lot] += pt::val[cands[i].cell];
+			val[cands[i].lot] += inst->val[cands[i].cell];
 		}
 		sum_xi = sum_xi_sq = 0;
-		for (int i = 0; i < pt::lots; ++i) {
+		for (int i = 0; i < inst->lots; ++i) {
 			ll v = val[i];
 			sum_xi += v;
 			sum_xi_sq += v * v;
+			refresh_sq_delta(i);
 		}
 	}
-	value = sum_xi_sq - (sum_xi * sum_xi) / pt::lots;
+	refresh_mean_term();
+	value = sum_xi_sq - (sum_xi * sum_xi) / inst->lots;
+	assert_value_acceptable();
+}
+
+void objective_function::do_moves(const viii &moves) {
+	if (moves.empty())
+		return;
+	for (auto &m : moves) {
+		int c, from, to;
+		tie(c, from, to) = m;
+		if (from != -1)
+			val[from] -= inst->val[c];
+		if (to != -1)
+			val[to] += inst->val[c];
+	}
+	sum_xi = sum_xi_sq = 0;
+	for (int i = 0; i < inst->lots; ++i) {
+		ll v = val[i];
+		sum_xi += v;
+		sum_xi_sq += v * v;
+		refresh_sq_delta(i);
+	}
+	refresh_mean_term();
+	value = sum_xi_sq - (sum_xi * sum_xi) / inst->lots;
 	assert_value_acceptable();
 }
 
 ll objective_function::compute_value_brute_force() const {
 	double sum = accumulate(val.begin(), val.end(), double(0));
-	double mean = sum / (double)pt::lots;
+	double mean = sum / (double)inst->lots;
 	double var = 0;
-	for (int i = 0; i < pt::lots; ++i) {
+	for (int i = 0; i < inst->lots; ++i) {
 		double x = (double)val[i] - mean;
 		var += x * x;
 	}
@@ -122,17 +176,19 @@ ll objective_function::compute_value_brute_force() const {
 }
 
 void objective_function::populate(const solution &s) {
-	val.assign(pt::lots, 0);
-	for (int i = 0; i < pt::nland; ++i)
+	val.assign(inst->lots, 0);
+	for (int i = 0; i < inst->nland; ++i)
 		if (s.assigned[i] != -1)
-			val[s.assigned[i]] += pt::val[i];
+			val[s.assigned[i]] += inst->val[i];
 	sum_xi = sum_xi_sq = 0;
-	for (int i = 0; i < pt::lots; ++i) {
+	for (int i = 0; i < inst->lots; ++i) {
 		ll v = val[i];
 		sum_xi += v;
 		sum_xi_sq += v * v;
+		refresh_sq_delta(i);
 	}
-	value = sum_xi_sq - (sum_xi * sum_xi / pt::lots);
+	refresh_mean_term();
+	value = sum_xi_sq - (sum_xi * sum_xi / inst->lots);
 #ifdef HARD_DEBUG
 	assert_value_acceptable();
 #endif
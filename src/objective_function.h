@@ -30,6 +30,7 @@
 
 struct solution;
 struct candidate;
+struct instance;
 
 struct objective_function {
   objective_function() = default;
@@ -39,12 +40,11 @@ struct objective_function {
 
   struct candidate {
     ll value = -1, sum_xi = -1, sum_xi_sq = -1;
-    int last_updated = -1;
     bool operator<(const candidate& sp) const { return value < sp.value; }
     bool operator==(const candidate& sp) const { return value == sp.value; }
   };
 
-  void init();
+  void init(const instance& inst);
 
   void calc_swap(int from, int to, int c, candidate& sp);
 
@@ -52,6 +52,9 @@ struct objective_function {
 
   void do_swaps(vector<::candidate>& candidates);
 
+  // Applies a list of (cell, old lot, new lot) moves; either lot may be -1.
+  void do_moves(const viii& moves);
+
   ll compute_value_brute_force() const;
 
   void assert_value_acceptable() const {
@@ -64,8 +67,27 @@ struct objective_function {
 
   void populate(const solution& s);
 
+  // Value of the objective after adding an unassigned cell of aptitude class k
+  // to lot to; the same value calc_swap(-1, to, c, sp) computes.
+  ll value_if_added(int to, int k) const {
+    return sum_xi_sq + sq_delta[to * num_classes + k] - mean_term[k];
+  }
+
+  const instance* inst = nullptr;
+
   ll value = 0;
   ll sum_xi_sq = 0;
   ll sum_xi = 0;
   vi val;
+
+  // Tables for value_if_added. sq_delta[l * num_classes + k] is the change of
+  // sum_xi_sq when a cell of class k joins lot l, and is refreshed only for
+  // lots whose value changed; mean_term[k] is (sum_xi + x_k)^2 / lots.
+  int num_classes = 0;
+  vll sq_delta, mean_term;
+
+private:
+  void refresh_sq_delta(int lot);
+
+  void refresh_mean_term();
 };
@@ -116,14 +116,76 @@ string prm::desc_si =
     " of the solution contained in the specified file";
 string prm::solution_input = "";
 
-string prm::desc_if = "input filename (.input file)";
+string prm::desc_conv =
+    "if this is set, the program will only convert the input instance to the "
+    "binary instance format and save it in the specified filename";
+string prm::convert_output = "";
+
+string prm::desc_if =
+    "input filename (.input file, binary instance or png image). text and "
+    "binary instances may be gzip-compressed";
 string prm::instance_name = "";
 string prm::input_filename = "";
 
+string prm::desc_lots =
+    "number of lots. by default, the number given in the instance is used; "
+    "png instances without a 'lots' text chunk require this option";
+int prm::lots = -1;
+
+string prm::desc_pt =
+    "number of threads used to parse text instance and solution files. only "
+    "files larger than 256 KiB per thread are split";
+int prm::parse_threads = 1;
+
+string prm::desc_order =
+    "order in which land cells are numbered: 'raster' (row by row), "
+    "'morton' or 'hilbert'. the space-filling curves keep cells that are "
+    "close in the map close in memory";
+string prm::cell_order = "raster";
+
+string prm::desc_sparse =
+    "store the grid of cell types and indices in run-length form, so that its "
+    "size depends on the number of runs of land rather than on the area of "
+    "the map. useful for large maps that are mostly preserve";
+bool prm::sparse_grid = false;
+
+string prm::desc_cache =
+    "keep the tables derived from the instance in a cache file next to it, "
+    "named after a hash of the instance and of the options they depend on, "
+    "and load them from there in later runs";
+bool prm::cache = false;
+
+string prm::desc_ll =
+    "keep the cells of each lot in a list in every solution, so that queries "
+    "about a lot take time proportional to its size instead of the number "
+    "of land cells";
+bool prm::lot_lists = false;
+
 string prm::desc_bat = "the constructive algorithm will assign this many cells "
                        "at each construction step";
 int prm::batch_size = 256;
 
+string prm::desc_ab =
+    "shrink the batch of each construction step as the construction "
+    "proceeds: it starts at 'batch_size' and decreases with the fraction of "
+    "the cells already assigned and with the fraction of the frontier taken "
+    "by other lots, down to 'min-batch-size'";
+bool prm::adaptive_batch = false;
+
+string prm::desc_mbat = "smallest batch size of the adaptive batch schedule";
+int prm::min_batch_size = 32;
+
+string prm::desc_cps =
+    "if positive, the batch sizes are scaled after every construction so "
+    "that the constructive builds about this many complete solutions per "
+    "second";
+double prm::constructions_per_second = 0;
+
+string prm::desc_ct =
+    "number of threads used to score the candidates of a construction step. "
+    "only steps with at least 32 queues of candidates per thread are split";
+int prm::construct_threads = 1;
+
 string prm::desc_nbs =
     "determines the neighbourhood of a cell: a neighbourhood of 4 means left, "
     "right, up and down; a neighbourhood of 8 also uses the diagonals";
@@ -143,9 +205,19 @@ void add_opt(const string& opt, T* var, const string var_desc,
 void prm::parse_cmd_line(int argc, char** argv) {
   desc.add_options()("help", "show help menu");
   add_opt("batch-size", &batch_size, desc_bat);
+  desc.add_options()("adaptive-batch", desc_ab.c_str());
+  add_opt("min-batch-size", &min_batch_size, desc_mbat);
+  add_opt("constructions-per-second", &constructions_per_second, desc_cps);
+  add_opt("construct-threads", &construct_threads, desc_ct);
   add_opt("in", &input_filename, desc_if, true);
+  add_opt("lots", &lots, desc_lots);
   add_opt("neighbourhood", &neighborhood_size, desc_nbs);
+  add_opt("cell-order", &cell_order, desc_order);
+  desc.add_options()("sparse-grid", desc_sparse.c_str());
+  desc.add_options()("cache", desc_cache.c_str());
   add_opt("solution", &solution_input, desc_si);
+  add_opt("convert", &convert_output, desc_conv);
+  add_opt("parse-threads", &parse_threads, desc_pt);
   add_opt("png", &png, desc_png);
   desc.add_options()("naive", desc_naive.c_str());
   add_opt("max-generations", &max_generations, desc_mgen);
@@ -154,6 +226,7 @@ void prm::parse_cmd_line(int argc, char** argv) {
   add_opt("size-ratio", &maximum_size_ratio, desc_msr);
   desc.add_options()("no-crossover", desc_dc.c_str());
   desc.add_options()("no-mutation", desc_dm.c_str());
+  desc.add_options()("lot-lists", desc_ll.c_str());
   add_opt("pop-size", &pop_size, desc_ps);
   add_opt("keep-ratio", &keep_ratio, desc_kr);
   add_opt("crossover-ratio", &crossover_ratio, desc_cr);
@@ -173,10 +246,19 @@ void prm::parse_cmd_line(int argc, char** argv) {
       po::notify(vm);
     }
 
+    if (cell_order != "raster" and cell_order != "morton" and
+        cell_order != "hilbert")
+      throw po::validation_error(po::validation_error::invalid_option_value,
+                                 "cell-order", cell_order);
+
     irace = vm.count("irace");
     naive = vm.count("naive");
+    sparse_grid = vm.count("sparse-grid");
+    cache = vm.count("cache");
     do_crossover = not vm.count("no-crossover");
     do_mutation = not vm.count("no-mutation");
+    lot_lists = vm.count("lot-lists");
+    adaptive_batch = vm.count("adaptive-batch");
 
     if (png.size() and png.find(".png") == string::npos) png += ".png";
 
@@ -35,13 +35,43 @@ struct prm {
   static string desc_nbs;
   static int neighborhood_size;
 
+  static string desc_order;
+  static string cell_order;
+
+  static string desc_sparse;
+  static bool sparse_grid;
+
+  static string desc_cache;
+  static bool cache;
+
   static string desc_bat;
   static int batch_size;
 
+  static string desc_ab;
+  static bool adaptive_batch;
+
+  static string desc_mbat;
+  static int min_batch_size;
+
+  static string desc_cps;
+  static double constructions_per_second;
+
+  static string desc_ct;
+  static int construct_threads;
+
   static string desc_if;
   static string input_filename;
   static string instance_name;
 
+  static string desc_lots;
+  static int lots;
+
+  static string desc_pt;
+  static int parse_threads;
+
+  static string desc_conv;
+  static string convert_output;
+
   static string desc_si;
   static string solution_input;
 
@@ -69,6 +99,9 @@ struct prm {
   static string desc_dm;
   static bool do_mutation;
 
+  static string desc_ll;
+  static bool lot_lists;
+
   static string desc_ps;
   static int pop_size;
 
@@ -23,84 +23,154 @@
 * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 */
 #include "proterra.h"
-#include "initial_positions.h"
+#include "lodepng/lodepng.h"
 #include "parameters.h"
 #include "random.h"
+#include "raster.h"
 #include "solution.h"
 #include "util.h"
 #include <cassert>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
 #include <fstream>
+#include <functional>
 #include <iostream>
 #include <map>
 #include <numeric>
 #include <queue>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include <tuple>
+#include <unistd.h>
 
 random_number_generator rng;
-int pt::river_pct, pt::num_apt_classes, pt::lots, pt::r_size, pt::c_size,
-    pt::nland, pt::nriver;
-vi pt::in_cell, pt::val;
-vb pt::nx_river, pt::global_border;
-vvi pt::neighbours, pt::index_from_rc;
-vii pt::rc_from_index;
-std::vector<std::vector<pt::cell_type_enum>> pt::cell_type;
-
-void pt::init() {
-  ifstream f(prm::input_filename);
-  if (f.fail())
-    throw runtime_error(
-        fmt::format("could not open input file {}", prm::input_filename));
-
-  int num_parcels = -1;
-  f >> r_size >> c_size >> num_parcels >> num_apt_classes >> river_pct;
-  if (num_parcels > 0 and lots <= 0) lots = num_parcels;
-
-  index_from_rc.assign(r_size, vi(c_size, -1));
-  cell_type.assign(r_size, vector<cell_type_enum>(c_size, land));
-  nland = nriver = 0;
-  for (int r = 0; r < r_size; ++r) {
-    for (int c = 0; c < c_size; ++c) {
-      int x;
-      if (not(bool)(f >> x))
-        throw runtime_error("Error: could not read cell input from instance.");
-      in_cell.push_back(x);
-      if (x == -1) {
-        cell_type[r][c] = river;
-        ++nriver;
-      } else if (x == 0 or x == -2) {
-        cell_type[r][c] = preserve;
-      } else {
-        cell_type[r][c] = land;
-        ++nland;
+// Position of cell (r, c) along a Morton (Z-order) curve over an n x n grid.
+ull morton_key(int n, int r, int c) {
+  ull key = 0;
+  for (int b = 0; (1 << b) < n; ++b)
+    key |= ull((c >> b) & 1) << (2 * b) | ull((r >> b) & 1) << (2 * b + 1);
+  return key;
+}
+
+// Position of cell (r, c) along a Hilbert curve over an n x n grid, n a power
+// of two.
+ull hilbert_key(int n, int r, int c) {
+  ull key = 0;
+  for (int s = n / 2; s > 0; s /= 2) {
+    int rr = (r & s) > 0, rc = (c & s) > 0;
+    key += ull(s) * s * ((3 * rc) ^ rr);
+    if (rr == 0) {
+      if (rc == 1) {
+        r = n - 1 - r;
+        c = n - 1 - c;
       }
+      swap(r, c);
     }
   }
-  vvii cc;
-  vvb visited(r_size, vb(c_size, false));
-  for (int r = 0; r < r_size; ++r)
-    for (int c = 0; c < c_size; ++c) {
-      if (cell_type[r][c] == land and not visited[r][c]) {
-        cc.push_back(vii());
-        visited[r][c] = true;
-        queue<ii> q;
-        q.push(mp(r, c));
-        while (q.size()) {
-          ii p = q.front();
-          q.pop();
-          cc.back().push_back(p);
-          for (int i = 0; i < prm::neighborhood_size; ++i) {
-            int nr = p.ff + dr[i], nc = p.ss + dc[i];
-            if (inside_boundaries(nr, nc) and cell_type[nr][nc] == land and
-                not visited[nr][nc]) {
-              visited[nr][nc] = true;
-              q.push(mp(nr, nc));
-            }
+  return key;
+}
+
+instance::instance(const string& filename) {
+  raster in;
+  if (not prm::cache) {
+    in.read(filename, prm::parse_threads);
+    derive(in);
+  } else {
+    ull key = raster::file_hash(filename);
+    for (ull x : {ull(prm::neighborhood_size), ull(prm::sparse_grid),
+                  ull(prm::lots), ull(hash<string>()(prm::cell_order)),
+                  ull(LOT_BITS)})
+      key = (key ^ x) * 1099511628211ull;
+    string cache_filename = fmt::format("{}.{:016x}.cache", filename, key);
+    if (load_cache(cache_filename))
+      pr("loaded instance tables from {}\n", cache_filename);
+    else {
+      in.read(filename, prm::parse_threads);
+      derive(in);
+      save_cache(cache_filename);
+    }
+  }
+  // Checked here rather than in derive, so that it also covers instances
+  // loaded from a cache.
+  // Lots are numbered from 0, so the largest index is lots - 1.
+  if (lots - 1 > nl<lot_t>::max())
+    throw runtime_error(format(
+        "{} lots do not fit in {}-bit lot indices; rebuild with a larger "
+        "LOT_BITS",
+        lots, LOT_BITS));
+}
+
+void instance::derive(const raster& in) {
+  raster_r_size = in.r_size;
+  raster_c_size = in.c_size;
+  num_apt_classes = in.num_apt_classes;
+  river_pct = in.river_pct;
+  lots = prm::lots > 0 ? prm::lots : in.lots;
+  if (lots <= 0)
+    throw runtime_error("the number of lots is unknown; set it with --lots");
+
+  int r_last = -1, c_last = -1;
+  r_origin = raster_r_size;
+  c_origin = raster_c_size;
+  for (int r = 0; r < raster_r_size; ++r)
+    for (int c = 0; c < raster_c_size; ++c) {
+      int x = in[r * raster_c_size + c];
+      if (x != 0 and x != -2) {
+        r_origin = min(r_origin, r);
+        c_origin = min(c_origin, c);
+        r_last = max(r_last, r);
+        c_last = max(c_last, c);
+      }
+    }
+  r_size = max(0, r_last - r_origin + 1);
+  c_size = max(0, c_last - c_origin + 1);
+  auto cell = [&](int i) {
+    return in[(i / c_size + r_origin) * raster_c_size + i % c_size + c_origin];
+  };
+
+  const int size = r_size * c_size;
+  index_from_rc.assign(size, -1);
+  cell_type.assign(size, land);
+  nland = nriver = 0;
+  for (int i = 0; i < size; ++i) {
+    int x = cell(i);
+    if (x == -1) {
+      cell_type[i] = river;
+      ++nriver;
+    } else if (x == 0 or x == -2) {
+      cell_type[i] = preserve;
+    } else {
+      cell_type[i] = land;
+      ++nland;
+    }
+  }
+  cc.clear();
+  vbyte visited(size, false);
+  for (int i = 0; i < size; ++i) {
+    if (cell_type[i] == land and not visited[i]) {
+      cc.push_back(vi());
+      visited[i] = true;
+      queue<int> q;
+      q.push(i);
+      while (q.size()) {
+        int p = q.front(), r = p / c_size, c = p % c_size;
+        q.pop();
+        cc.back().push_back(p);
+        for (int j = 0; j < prm::neighborhood_size; ++j) {
+          int nr = r + dr[j], nc = c + dc[j];
+          if (not inside_boundaries(nr, nc)) continue;
+          int o = offset(nr, nc);
+          if (cell_type[o] == land and not visited[o]) {
+            visited[o] = true;
+            q.push(o);
           }
         }
       }
     }
+  }
 
-  vi cc_num_lots(cc.size());
+  cc_num_lots.assign(cc.size(), 0);
   int sum = 0;
   pr("found {} connected components\n", cc.size());
   for (int i = 0; i < (int)cc.size(); ++i) {
@@ -108,16 +178,14 @@ void pt::init() {
     pr("{} ", cc_num_lots[i]);
     sum += cc_num_lots[i];
     if (cc_num_lots[i] == 0)
-      for (auto& p : cc[i]) {
-        in_cell[p.ff * c_size + p.ss] = -2;
-        cell_type[p.ff][p.ss] = preserve;
-      }
+      for (int p : cc[i])
+        cell_type[p] = preserve;
   }
   pr("\n");
-  pr("proterra::lots: {}, sum: {}\n", pt::lots, sum);
+  pr("proterra::lots: {}, sum: {}\n", lots, sum);
   for (auto& i : cc_num_lots)
     if (i > 1) {
-      i += (pt::lots - sum);
+      i += (lots - sum);
       break;
     }
   for (auto& i : cc_num_lots)
@@ -125,83 +193,389 @@ void pt::init() {
   pr("\n");
 
   assert((int)accumulate(cc_num_lots.begin(), cc_num_lots.end(), 0) == lots);
-  initial_positions::cc_num_lots = move(cc_num_lots);
+  vi order;
+  for (int i = 0; i < size; ++i)
+    if (cell_type[i] == land) order.push_back(i);
+  if (prm::cell_order != "raster") {
+    int n = 1;
+    while (n < max(r_size, c_size)) n *= 2;
+    auto key = prm::cell_order == "hilbert" ? hilbert_key : morton_key;
+    vector<pair<ull, int>> keys;
+    for (int i : order)
+      keys.emplace_back(key(n, i / c_size, i % c_size), i);
+    sort(keys.begin(), keys.end());
+    for (int i = 0; i < (int)order.size(); ++i)
+      order[i] = keys[i].ss;
+  }
+
   nland = 0;
-  int num_preserve = 0;
-  for (int i = 0; i < (int)in_cell.size(); ++i) {
+  for (int i : order) {
     int r = i / c_size, c = i % c_size;
-    if (cell_type[r][c] == land) {
-      assert(in_cell[i] > 0);
-      bool is_next_to_river = false;
-      bool is_border = false;
-      for (int j = 0; j < prm::neighborhood_size; ++j) {
-        int nr = r + dr[j], nc = c + dc[j];
-        if (inside_boundaries(nr, nc)) {
-          if (cell_type[nr][nc] == river) {
-            assert(in_cell[nr * c_size + nc] == -1);
-            is_next_to_river = true;
-          } else if (cell_type[nr][nc] == preserve) {
-            assert(in_cell[nr * c_size + nc] == 0 or
-                   in_cell[nr * c_size + nc] == -2);
-            is_border = true;
-          }
-        } else {
+    assert(cell(i) > 0);
+    bool is_next_to_river = false;
+    bool is_border = false;
+    for (int j = 0; j < prm::neighborhood_size; ++j) {
+      int nr = r + dr[j], nc = c + dc[j];
+      if (inside_boundaries(nr, nc)) {
+        int o = offset(nr, nc);
+        if (cell_type[o] == river) {
+          assert(cell(o) == -1);
+          is_next_to_river = true;
+        } else if (cell_type[o] == preserve) {
+          assert(cell(o) != -1);
           is_border = true;
         }
+      } else {
+        is_border = true;
       }
-      index_from_rc[r][c] = nland;
-      rc_from_index.emplace_back(r, c);
-      val.push_back(in_cell[i]);
-      nx_river.push_back(is_next_to_river);
-      global_border.push_back(is_border);
-      ++nland;
-    } else if (cell_type[r][c] == preserve) {
-      ++num_preserve;
     }
+    index_from_rc[i] = nland;
+    rc_from_index.emplace_back(r, c);
+    val.push_back(cell(i));
+    nx_river.push_back(is_next_to_river);
+    global_border.push_back(is_border);
+    ++nland;
   }
 
   assert(nland == (int)val.size());
-  neighbours.resize(nland);
+  apt_values = val;
+  sort(apt_values.begin(), apt_values.end());
+  apt_values.erase(unique(apt_values.begin(), apt_values.end()),
+                   apt_values.end());
+  apt_class.resize(nland);
+  for (int i = 0; i < nland; ++i)
+    apt_class[i] = lower_bound(apt_values.begin(), apt_values.end(), val[i]) -
+                   apt_values.begin();
+
+  neighbours.offsets.assign(1, 0);
+  neighbours.targets.clear();
+  neighbours.targets.reserve((size_t)nland * prm::neighborhood_size);
   for (int i = 0; i < nland; ++i) {
     int r, c;
     tie(r, c) = rc_from_index[i];
-    neighbours[i] = vi();
     for (int j = 0; j < prm::neighborhood_size; ++j) {
       int nr = r + dr[j], nc = c + dc[j];
-      if (inside_boundaries(nr, nc) and cell_type[nr][nc] == land) {
-        assert(index_from_rc[nr][nc] != -1);
-        neighbours[i].push_back(index_from_rc[nr][nc]);
+      if (inside_boundaries(nr, nc) and cell_type[offset(nr, nc)] == land) {
+        assert(index_from_rc[offset(nr, nc)] != -1);
+        neighbours.targets.push_back(index_from_rc[offset(nr, nc)]);
       }
     }
+    neighbours.offsets.push_back(neighbours.targets.size());
   }
-  initial_positions::cc.assign(cc.size(), vi());
+  neighbours.targets.shrink_to_fit();
   for (int i = 0; i < (int)cc.size(); ++i) {
-    if (initial_positions::cc_num_lots[i] == 0) continue;
-    for (auto& p : cc[i]) {
-      assert(cell_type[p.ff][p.ss] == land);
-      initial_positions::cc[i].push_back(index_from_rc[p.ff][p.ss]);
+    if (cc_num_lots[i] == 0) {
+      cc[i].clear();
+      continue;
+    }
+    for (int& p : cc[i]) {
+      assert(cell_type[p] == land);
+      p = index_from_rc[p];
     }
   }
+  if (prm::sparse_grid) build_runs();
 }
 
-void pt::read_solution(solution& s, const string& solution_input_filename) {
-  ifstream f(solution_input_filename);
-  if (not f or f.fail()) {
-    throw runtime_error(
-        fmt::format("could not open input file {}", solution_input_filename));
+namespace {
+const char cache_magic[8] = {'P', 'T', 'C', 'A', 'C', 'H', 'E', '4'};
+
+// Reads the fields written by cache_writer, in the same order, checking that
+// they stay within the buffer.
+struct cache_reader {
+  const char *p, *end;
+
+  template <typename T> bool get(T& x) {
+    if (size_t(end - p) < sizeof(T)) return false;
+    memcpy(&x, p, sizeof(T));
+    p += sizeof(T);
+    return true;
+  }
+
+  template <typename T> bool get(vector<T>& v) {
+    ull n;
+    if (not get(n) or n > size_t(end - p) / sizeof(T)) return false;
+    v.resize(n);
+    if (n) memcpy(static_cast<void*>(v.data()), p, n * sizeof(T));
+    p += n * sizeof(T);
+    return true;
   }
-  vi assigned(pt::nland, -1);
+
+  bool get(vb& v) {
+    vbyte bytes;
+    if (not get(bytes)) return false;
+    v.assign(bytes.begin(), bytes.end());
+    return true;
+  }
+
+  bool get(bool& b) {
+    uchar x;
+    if (not get(x) or x > 1) return false;
+    b = x;
+    return true;
+  }
+
+  // Field by field, as cache_writer writes them.
+  bool get(vector<instance::grid_run>& v) {
+    const size_t run_size = 2 * sizeof(int) + sizeof(uchar);
+    ull n;
+    if (not get(n) or n > size_t(end - p) / run_size) return false;
+    v.resize(n);
+    for (auto& g : v) {
+      uchar type = 0;
+      get(g.col, g.land, type);
+      g.type = instance::cell_type_enum(type);
+    }
+    return true;
+  }
+
+  template <typename T, typename... Ts> bool get(T& x, Ts&... xs) {
+    return get(x) and get(xs...);
+  }
+};
+
+// Checks that the tables read from a cache file fit together, so that a file
+// that parses but was damaged is not taken for a valid instance: every index
+// the solver follows without checking must be in range, and the grid must map
+// each land cell to its index and back.
+bool consistent(const instance& t, const vi& cc_sizes, const vi& cc_cells) {
+  const int n = t.nland;
+  if (n < 0 or t.r_size < 0 or t.c_size < 0 or t.lots <= 0 or
+      t.sparse_grid != prm::sparse_grid)
+    return false;
+  for (size_t size : {t.val.size(), t.apt_class.size(), t.global_border.size(),
+                      t.nx_river.size(), t.rc_from_index.size()})
+    if (size != size_t(n)) return false;
+  for (int i = 0; i < n; ++i) {
+    int k = t.apt_class[i];
+    if (k < 0 or k >= (int)t.apt_values.size() or t.apt_values[k] != t.val[i])
+      return false;
+  }
+  for (const ii& rc : t.rc_from_index)
+    if (not t.inside_boundaries(rc.ff, rc.ss)) return false;
+
+  const vi& offsets = t.neighbours.offsets;
+  if (offsets.size() != size_t(n) + 1 or offsets[0] != 0 or
+      offsets[n] != (int)t.neighbours.targets.size())
+    return false;
+  for (int i = 0; i < n; ++i)
+    if (offsets[i] > offsets[i + 1]) return false;
+  for (int c : t.neighbours.targets)
+    if (c < 0 or c >= n) return false;
+
+  // Each row is covered by runs in increasing columns, starting at column 0,
+  // and the land runs take consecutive stretches of raster_index.
+  const size_t size = size_t(t.r_size) * t.c_size;
+  if (t.sparse_grid) {
+    if (t.row_runs.size() != size_t(t.r_size) + 1 or t.row_runs[0] != 0 or
+        t.row_runs.back() != (int)t.runs.size())
+      return false;
+    size_t land = 0;
+    for (int r = 0; r < t.r_size; ++r) {
+      int first = t.row_runs[r], last = t.row_runs[r + 1];
+      if (first >= last or last > (int)t.runs.size() or t.runs[first].col != 0)
+        return false;
+      for (int i = first; i < last; ++i) {
+        const instance::grid_run& g = t.runs[i];
+        int end = i + 1 < last ? t.runs[i + 1].col : t.c_size;
+        if (g.col >= end or g.type > instance::preserve) return false;
+        if (g.type == instance::land) {
+          if (g.land != (int)land) return false;
+          land += end - g.col;
+        }
+      }
+    }
+    if (land != size_t(n) or t.raster_index.size() != size_t(n)) return false;
+    for (int i : t.raster_index)
+      if (i < 0 or i >= n) return false;
+  } else {
+    if (t.index_from_rc.size() != size or t.cell_type.size() != size)
+      return false;
+    for (size_t o = 0; o < size; ++o) {
+      int i = t.index_from_rc[o];
+      if (t.cell_type[o] > instance::preserve or i < -1 or i >= n or
+          (t.cell_type[o] == instance::land) != (i != -1))
+        return false;
+    }
+  }
+  for (int i = 0; i < n; ++i)
+    if (t.index_at(t.rc_from_index[i].ff, t.rc_from_index[i].ss) != i)
+      return false;
+
+  // The neighbours of a cell are distinct cells of its neighbourhood; as cells
+  // and positions now correspond one to one, distinct positions suffice.
+  for (int i = 0; i < n; ++i) {
+    auto nbs = t.neighbours[i];
+    if (nbs.size() > prm::neighborhood_size) return false;
+    for (const int* p = nbs.begin(); p != nbs.end(); ++p) {
+      int dr = abs(t.rc_from_index[*p].ff - t.rc_from_index[i].ff),
+          dc = abs(t.rc_from_index[*p].ss - t.rc_from_index[i].ss);
+      if (max(dr, dc) != 1 or (prm::neighborhood_size == 4 and dr + dc != 1) or
+          find(nbs.begin(), p, *p) != p)
+        return false;
+    }
+  }
+
+  // The components partition the land cells among the lots; those without a
+  // lot are empty.
+  if (cc_sizes.size() != t.cc_num_lots.size()) return false;
+  ll sum = 0, sum_lots = 0;
+  for (int i = 0; i < (int)cc_sizes.size(); ++i) {
+    int lots = t.cc_num_lots[i];
+    if (cc_sizes[i] < 0 or lots < 0 or lots > cc_sizes[i] or
+        (lots == 0 and cc_sizes[i] != 0))
+      return false;
+    sum += cc_sizes[i];
+    sum_lots += lots;
+  }
+  if (sum != (ll)cc_cells.size() or sum_lots != t.lots) return false;
+  for (int c : cc_cells)
+    if (c < 0 or c >= n) return false;
+  return true;
+}
+
+struct cache_writer {
+  string& out;
+
+  template <typename T> void put(const T& x) {
+    out.append(reinterpret_cast<const char*>(&x), sizeof(T));
+  }
+
+  template <typename T> void put(const vector<T>& v) {
+    put(ull(v.size()));
+    out.append(reinterpret_cast<const char*>(v.data()), v.size() * sizeof(T));
+  }
+
+  void put(const vb& v) { put(vbyte(v.begin(), v.end())); }
+
+  void put(bool b) { put(uchar(b)); }
+
+  // Field by field, so that the padding of a run is not written.
+  void put(const vector<instance::grid_run>& v) {
+    put(ull(v.size()));
+    for (auto& g : v) put(g.col, g.land, uchar(g.type));
+  }
+
+  template <typename T, typename... Ts> void put(const T& x, const Ts&... xs) {
+    put(x);
+    put(xs...);
+  }
+};
+}
+
+// The cache file holds a magic string, the width of lot indices it was built
+// for, the CRC-32 of the rest of the file and every field of the instance. It
+// is memory-mapped and the tables are copied out of the mapping; any file that
+// is truncated, fails the checksum or otherwise does not parse is ignored and
+// rebuilt. The fields are read into a separate instance, so that a bad file
+// leaves this one untouched.
+bool instance::load_cache(const string& filename) {
+  int fd = open(filename.c_str(), O_RDONLY);
+  if (fd == -1) return false;
+  struct stat st;
+  void* mapping = MAP_FAILED;
+  if (fstat(fd, &st) == 0 and st.st_size > 0)
+    mapping = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (mapping == MAP_FAILED) return false;
+
+  const char* data = static_cast<const char*>(mapping);
+  cache_reader f{data, data + st.st_size};
+  char magic[sizeof(cache_magic)];
+  int32_t lot_bits;
+  uint32_t crc;
+  vi cc_sizes, cc_cells;
+  instance t;
+  bool ok =
+      f.get(magic) and memcmp(magic, cache_magic, sizeof(magic)) == 0 and
+      f.get(lot_bits) and lot_bits == LOT_BITS and f.get(crc) and
+      lodepng_crc32(reinterpret_cast<const uchar*>(f.p), f.end - f.p) == crc and
+      f.get(t.river_pct, t.nland, t.nriver, t.c_size, t.r_size, t.lots,
+            t.num_apt_classes, t.r_origin, t.c_origin, t.raster_r_size,
+            t.raster_c_size, t.val, t.apt_values, t.apt_class, t.global_border,
+            t.nx_river, t.neighbours.offsets, t.neighbours.targets,
+            t.rc_from_index, t.index_from_rc, t.cell_type, t.sparse_grid,
+            t.row_runs, t.raster_index, t.runs, cc_sizes, cc_cells,
+            t.cc_num_lots) and
+      f.p == f.end and consistent(t, cc_sizes, cc_cells);
+  munmap(mapping, st.st_size);
+  if (not ok) return false;
+  t.cc.assign(cc_sizes.size(), vi());
+  auto p = cc_cells.begin();
+  for (int i = 0; i < (int)t.cc.size(); ++i) {
+    t.cc[i].assign(p, p + cc_sizes[i]);
+    p += cc_sizes[i];
+  }
+  *this = move(t);
+  return true;
+}
+
+void instance::save_cache(const string& filename) const {
+  // Write to a private file and rename it, so that concurrent runs never see
+  // a partial cache.
+  string tmp_filename = fmt::format("{}.{}.tmp", filename, getpid());
+  vi cc_sizes, cc_cells;
+  for (const vi& c : cc) {
+    cc_sizes.push_back(c.size());
+    cc_cells.insert(cc_cells.end(), c.begin(), c.end());
+  }
+  string header, payload;
+  cache_writer f{payload};
+  f.put(river_pct, nland, nriver, c_size, r_size, lots, num_apt_classes,
+        r_origin, c_origin, raster_r_size, raster_c_size, val, apt_values,
+        apt_class, global_border, nx_river, neighbours.offsets,
+        neighbours.targets, rc_from_index, index_from_rc, cell_type,
+        sparse_grid, row_runs, raster_index, runs, cc_sizes, cc_cells,
+        cc_num_lots);
+  cache_writer h{header};
+  h.put(cache_magic, int32_t(LOT_BITS),
+        uint32_t(lodepng_crc32(
+            reinterpret_cast<const uchar*>(payload.data()), payload.size())));
+  ofstream out(tmp_filename, ios::binary);
+  out.write(header.data(), header.size());
+  out.write(payload.data(), payload.size());
+  out.close();
+  if (out.fail() or rename(tmp_filename.c_str(), filename.c_str()) != 0) {
+    remove(tmp_filename.c_str());
+    pr("could not write cache file {}\n", filename);
+  }
+}
+
+void instance::build_runs() {
+  row_runs.assign(1, 0);
+  runs.clear();
+  raster_index.clear();
+  for (int r = 0; r < r_size; ++r) {
+    for (int c = 0; c < c_size; ++c) {
+      int o = offset(r, c);
+      if (c == 0 or cell_type[o] != runs.back().type)
+        runs.push_back({c, (int)raster_index.size(), cell_type[o]});
+      if (cell_type[o] == land) raster_index.push_back(index_from_rc[o]);
+    }
+    row_runs.push_back(runs.size());
+  }
+  runs.shrink_to_fit();
+  vi().swap(index_from_rc);
+  vector<cell_type_enum>().swap(cell_type);
+  sparse_grid = true;
+}
+
+void instance::read_solution(solution& s,
+                             const string& solution_input_filename) const {
+  vi values = raster::read_values(solution_input_filename,
+                                  raster_r_size * raster_c_size,
+                                  prm::parse_threads);
+  vlot assigned(nland, -1);
   map<int, int> ss;
   int lot_num = 0;
-  for (int i = 0; i < r_size; ++i)
-    for (int j = 0; j < c_size; ++j) {
-      int x;
-      f >> x;
-      int index = index_from_rc[i][j];
-      if (x == -1 or x == 0 or index < 0 or index >= pt::nland) continue;
+  for (int i = 0; i < raster_r_size; ++i)
+    for (int j = 0; j < raster_c_size; ++j) {
+      int x = values[i * raster_c_size + j];
+      int r = i - r_origin, c = j - c_origin;
+      int index = inside_boundaries(r, c) ? index_at(r, c) : -1;
+      if (x == -1 or x == 0 or index < 0 or index >= nland) continue;
       if (ss.find(x) == ss.end()) ss[x] = lot_num++;
       assigned[index] = ss[x];
     }
-  s.init();
+  s = solution(*this);
   s.populate(assigned);
 }
@@ -28,27 +28,120 @@
 #include <string>
 #include <vector>
 
+struct raster;
 struct solution;
 
-struct pt {
-  static void init();
+// Adjacency lists in compressed sparse row form: the neighbours of cell i are
+// targets[offsets[i]], ..., targets[offsets[i + 1] - 1].
+struct adjacency {
+  struct range {
+    const int* begin() const { return first; }
+    const int* end() const { return last; }
+    int size() const { return int(last - first); }
+    const int *first, *last;
+  };
 
-  static void read_solution(solution&, const string& filename);
+  range operator[](int i) const {
+    return {targets.data() + offsets[i], targets.data() + offsets[i + 1]};
+  }
+
+  vi offsets, targets;
+};
+
+// A loaded instance: the land cells and all tables derived from the raster.
+// An instance is built once and never modified afterwards, so a single one can
+// be shared by any number of solutions, solvers and threads.
+struct instance {
+  explicit instance(const string& filename);
+  instance(const instance&) = delete;
+  instance& operator=(const instance&) = delete;
 
-  static bool inside_boundaries(int r, int c) {
+  void read_solution(solution&, const string& filename) const;
+
+  bool inside_boundaries(int r, int c) const {
     return r >= 0 and r < r_size and c >= 0 and c < c_size;
   }
 
-  static int river_pct, nland, nriver, c_size, r_size, lots, num_apt_classes;
+  // Position of cell (r, c) in the row-major grid tables.
+  int offset(int r, int c) const { return r * c_size + c; }
+
+  enum cell_type_enum : uchar { river, land, preserve };
+
+  // Type and land index (-1 if not land) of cell (r, c), in either grid form.
+  cell_type_enum type_at(int r, int c) const {
+    return sparse_grid ? run_at(r, c).type : cell_type[offset(r, c)];
+  }
+
+  int index_at(int r, int c) const {
+    if (not sparse_grid) return index_from_rc[offset(r, c)];
+    const grid_run& g = run_at(r, c);
+    return g.type == land ? raster_index[g.land + c - g.col] : -1;
+  }
+
+  int river_pct, nland, nriver, c_size, r_size, lots = -1, num_apt_classes;
+
+  // The raster is cropped to the bounding box of its land and river cells:
+  // cell (r, c) here is cell (r + r_origin, c + c_origin) of the raster, which
+  // has raster_r_size x raster_c_size cells. Everything outside is preserve.
+  int r_origin, c_origin, raster_r_size, raster_c_size;
+
+  vi val;
+
+  // Distinct aptitude values in increasing order, and the index into it of the
+  // value of each land cell.
+  vi apt_values, apt_class;
 
-  static vi in_cell, val;
+  vb global_border, nx_river;
 
-  static vb global_border, nx_river;
+  adjacency neighbours;
 
-  static vvi neighbours, index_from_rc;
+  vii rc_from_index;
 
-  static vii rc_from_index;
+  // Dense grid tables, one entry per cell of the cropped raster. They are
+  // empty if the grid is stored in run-length form.
+  vi index_from_rc;
+
+  vector<cell_type_enum> cell_type;
+
+  // Run-length form of the grid tables, used with --sparse-grid. The cells of
+  // row r are covered by runs[row_runs[r]], ..., runs[row_runs[r + 1] - 1],
+  // each a maximal stretch of cells of one type starting at column col. The
+  // land indices of the cells of a land run are stored consecutively in
+  // raster_index, starting at position land.
+  struct grid_run {
+    int col, land;
+    cell_type_enum type;
+  };
+
+  bool sparse_grid = false;
+
+  vi row_runs, raster_index;
+
+  vector<grid_run> runs;
+
+  // Land cells of each connected component, and the number of lots placed in
+  // it. Components too small for a lot are turned into preserve.
+  vvi cc;
+
+  vi cc_num_lots;
+
+private:
+  instance() = default;
+  instance& operator=(instance&&) = default;
+
+  void derive(const raster& in);
+
+  bool load_cache(const string& filename);
+
+  void save_cache(const string& filename) const;
+
+  const grid_run& run_at(int r, int c) const {
+    auto first = runs.begin() + row_runs[r];
+    auto last = runs.begin() + row_runs[r + 1];
+    return *prev(upper_bound(first, last, c, [](int c, const grid_run& g) {
+      return c < g.col;
+    }));
+  }
 
-  enum cell_type_enum { river, land, preserve };
-  static vector<vector<cell_type_enum>> cell_type;
+  void build_runs();
 };
@@ -0,0 +1,436 @@
+/*
+* A genetic algorithm for fair land allocation
+* Copyright (c) 2017 Alex Gliesch, Marcus Ritt, Mayron C. O. Moreira
+*
+* Permission is hereby granted, free of charge, to any person (the "Person")
+* obtaining a copy of this software and associated documentation files (the
+* "Software"), to deal in the Software, including the rights to use, copy, modify,
+* merge, publish, distribute the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* 1. The above copyright notice and this permission notice shall be included in
+*    all copies or substantial portions of the Software.
+* 2. Under no circumstances shall the Person be permitted, allowed or authorized
+*    to commercially exploit the Software.
+* 3. Changes made to the original Software shall be labeled, demarcated or
+*    otherwise identified and attributed to the Person.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+* FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+* COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+* IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+* CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+#include "raster.h"
+#include "lodepng/lodepng.h"
+#include "util.h"
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <fcntl.h>
+#include <fstream>
+#include <memory>
+#include <stdexcept>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <thread>
+#include <unistd.h>
+
+namespace {
+const char magic[8] = {'P', 'T', 'R', 'A', 'S', 'T', '0', '1'};
+
+struct binary_header {
+  char magic[8];
+  int32_t r_size, c_size, lots, num_apt_classes, river_pct;
+};
+
+bool is_gzip(const unsigned char* d, size_t n) {
+  return n >= 2 and d[0] == 0x1f and d[1] == 0x8b;
+}
+
+// Only the usual header of deflate with a 32 KiB window and no preset
+// dictionary is recognized: looser checks also match text such as "80".
+bool is_zlib(const unsigned char* d, size_t n) {
+  return n >= 2 and d[0] == 0x78 and (d[1] & 0x20) == 0 and
+         (d[0] * 256 + d[1]) % 31 == 0;
+}
+
+uint32_t read_le32(const unsigned char* d) {
+  return d[0] | d[1] << 8 | d[2] << 16 | uint32_t(d[3]) << 24;
+}
+
+enum scan_status { scan_end, scan_ok, scan_malformed };
+
+bool is_space(char c) { return c == ' ' or (c >= '\t' and c <= '\r'); }
+
+// Reads the next whitespace-separated integer starting at p. A token must be
+// an optional sign followed by at most 18 digits and end at whitespace or at
+// the end of the buffer, otherwise it is malformed.
+inline scan_status scan(const char*& p, const char* end, ll& x) {
+  while (p != end and is_space(*p)) p++;
+  if (p == end) return scan_end;
+  bool negative = *p == '-';
+  if (*p == '-' or *p == '+') p++;
+  const char* digits = p;
+  ll v = 0;
+  while (p != end and unsigned(*p - '0') < 10 and p - digits < 18)
+    v = v * 10 + (*p++ - '0');
+  if (p == digits or (p != end and not is_space(*p))) return scan_malformed;
+  x = negative ? -v : v;
+  return scan_ok;
+}
+
+struct chunk {
+  const char *begin, *end;
+  int n = 0;
+  scan_status status = scan_end;
+  ll bad = 0; // the first value out of range, if any
+};
+
+// Parses at most limit values of c into out, stopping at the end of the chunk
+// or at the first malformed or out-of-range value.
+template <typename T> void parse(chunk& c, T* out, int limit) {
+  const char* p = c.begin;
+  ll x;
+  while (c.n < limit and (c.status = scan(p, c.end, x)) == scan_ok) {
+    if (x < nl<T>::min() or x > nl<T>::max()) {
+      c.status = scan_malformed;
+      c.bad = x;
+      return;
+    }
+    out[c.n++] = x;
+  }
+}
+
+// Parses count values from [begin, end) into out. With more than one thread
+// the buffer is cut at whitespace into one chunk per thread; each chunk is
+// parsed into its own buffer and the results are concatenated. Trailing
+// content after the first count values is ignored, as with operator>>.
+template <typename T>
+void parse_values(const char* begin, const char* end, T* out, int count,
+                  int threads) {
+  const size_t length = end - begin;
+  threads = max(1, min<int>(threads, length / (1 << 18)));
+  vector<chunk> chunks(threads);
+  vector<vector<T>> buffers(threads);
+  const char* p = begin;
+  for (int t = 0; t < threads; ++t) {
+    chunks[t].begin = p;
+    p = t + 1 == threads ? end : max(p, begin + length * (t + 1) / threads);
+    while (p != end and not is_space(*p)) p++;
+    chunks[t].end = p;
+  }
+
+  if (threads == 1)
+    parse(chunks[0], out, count);
+  else {
+    vector<thread> workers;
+    for (int t = 0; t < threads; ++t)
+      workers.emplace_back([&, t]() {
+        chunk& c = chunks[t];
+        buffers[t].resize(min<size_t>(count, (c.end - c.begin + 1) / 2));
+        parse(c, buffers[t].data(), buffers[t].size());
+      });
+    for (auto& w : workers) w.join();
+  }
+
+  int n = 0;
+  for (int t = 0; t < threads and n < count; ++t) {
+    const chunk& c = chunks[t];
+    int take = min(c.n, count - n);
+    if (threads > 1) copy_n(buffers[t].begin(), take, out + n);
+    n += take;
+    if (n < count and c.status == scan_malformed) {
+      if (c.bad != 0)
+        throw runtime_error(fmt::format("cell value {} out of range", c.bad));
+      break;
+    }
+  }
+  if (n < count)
+    throw runtime_error("Error: could not read cell input from instance.");
+}
+
+// Reads a whole file into memory.
+vector<char> read_file(const string& filename) {
+  ifstream f(filename, ios::binary | ios::ate);
+  if (f.fail())
+    throw runtime_error(fmt::format("could not open input file {}", filename));
+  vector<char> data(f.tellg());
+  f.seekg(0);
+  if (not f.read(data.data(), data.size()))
+    throw runtime_error(fmt::format("could not read input file {}", filename));
+  return data;
+}
+
+// Skips the header of a single-member gzip file (RFC 1952) and returns the
+// offset of the deflate stream, or 0 if the header is malformed.
+size_t gzip_payload(const unsigned char* d, size_t n) {
+  enum { fhcrc = 2, fextra = 4, fname = 8, fcomment = 16 };
+  if (n < 18 or d[2] != 8) return 0;
+  const unsigned flags = d[3];
+  size_t p = 10;
+  if (flags & fextra) {
+    if (p + 2 > n) return 0;
+    p += 2 + (d[p] | d[p + 1] << 8);
+  }
+  for (unsigned f : {fname, fcomment})
+    if (flags & f) {
+      while (p < n and d[p] != 0) p++;
+      p++;
+    }
+  if (flags & fhcrc) p += 2;
+  return p + 8 <= n ? p : 0;
+}
+}
+
+raster::~raster() {
+  if (mapping != nullptr) munmap(mapping, mapping_size);
+}
+
+bool raster::is_binary(const string& filename) {
+  ifstream f(filename, ios::binary);
+  char m[sizeof(magic)];
+  return f.read(m, sizeof(m)) and memcmp(m, magic, sizeof(magic)) == 0;
+}
+
+bool raster::is_compressed(const string& filename) {
+  ifstream f(filename, ios::binary);
+  unsigned char m[2];
+  if (not f.read(reinterpret_cast<char*>(m), sizeof(m))) return false;
+  return is_gzip(m, sizeof(m)) or is_zlib(m, sizeof(m));
+}
+
+bool raster::is_png(const string& filename) {
+  ifstream f(filename, ios::binary);
+  const char signature[8] = {'\x89', 'P', 'N', 'G', '\r', '\n', '\x1a', '\n'};
+  char m[sizeof(signature)];
+  return f.read(m, sizeof(m)) and memcmp(m, signature, sizeof(m)) == 0;
+}
+
+void raster::read(const string& filename, int threads) {
+  if (is_binary(filename))
+    read_binary(filename);
+  else if (is_png(filename))
+    read_png(filename);
+  else if (is_compressed(filename))
+    read_compressed(filename, threads);
+  else {
+    vector<char> data = read_file(filename);
+    read_text(data.data(), data.data() + data.size(), threads);
+  }
+}
+
+vi raster::read_values(const string& filename, int count, int threads) {
+  vector<char> data = read_file(filename);
+  vi values(count);
+  parse_values(data.data(), data.data() + data.size(), values.data(), count,
+               threads);
+  return values;
+}
+
+void raster::check_size() const {
+  if (r_size < 0 or c_size < 0)
+    throw runtime_error("Error: could not read cell input from instance.");
+  if (size() > nl<int>::max())
+    throw runtime_error(fmt::format(
+        "instance of {} x {} cells is too large", r_size, c_size));
+}
+
+void raster::read_text(const char* begin, const char* end, int threads) {
+  ll header[5];
+  for (ll& h : header)
+    if (scan(begin, end, h) != scan_ok or h < nl<int>::min() or
+        h > nl<int>::max())
+      throw runtime_error("Error: could not read cell input from instance.");
+  r_size = header[0];
+  c_size = header[1];
+  lots = header[2];
+  num_apt_classes = header[3];
+  river_pct = header[4];
+  check_size();
+
+  storage.resize(size());
+  parse_values(begin, end, storage.data(), size(), threads);
+  cells = storage.data();
+}
+
+void raster::read_binary(const string& filename) {
+  int fd = open(filename.c_str(), O_RDONLY);
+  if (fd == -1)
+    throw runtime_error(fmt::format("could not open input file {}", filename));
+  struct stat st;
+  if (fstat(fd, &st) == -1 or st.st_size < (off_t)sizeof(binary_header)) {
+    close(fd);
+    throw runtime_error(
+        fmt::format("invalid binary instance file {}", filename));
+  }
+  mapping_size = st.st_size;
+  mapping = mmap(nullptr, mapping_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (mapping == MAP_FAILED) {
+    mapping = nullptr;
+    throw runtime_error(fmt::format("could not map input file {}", filename));
+  }
+
+  read_binary(mapping, mapping_size);
+}
+
+void raster::read_binary(const void* data, size_t length) {
+  const binary_header* h = static_cast<const binary_header*>(data);
+  if (length < sizeof(binary_header))
+    throw runtime_error("Error: could not read cell input from instance.");
+  r_size = h->r_size;
+  c_size = h->c_size;
+  lots = h->lots;
+  num_apt_classes = h->num_apt_classes;
+  river_pct = h->river_pct;
+  check_size();
+  if (length < sizeof(binary_header) + size() * sizeof(int16_t))
+    throw runtime_error("Error: could not read cell input from instance.");
+  cells = reinterpret_cast<const int16_t*>(h + 1);
+}
+
+// Inflates the whole file into one buffer and parses it from there. The bundled
+// inflater works on complete buffers only, so the compressed file is read into
+// memory first; no decompressed copy ever touches the disk.
+void raster::read_compressed(const string& filename, int threads) {
+  vector<char> packed = read_file(filename);
+  const unsigned char* d = reinterpret_cast<unsigned char*>(packed.data());
+  const size_t n = packed.size();
+
+  unsigned char* data = nullptr;
+  size_t length = 0;
+  unsigned error;
+  size_t p = 0;
+  if (is_gzip(d, n)) {
+    p = gzip_payload(d, n);
+    if (p == 0)
+      throw runtime_error(fmt::format("invalid gzip header in {}", filename));
+    error = lodepng_inflate(&data, &length, d + p, n - p - 8,
+                            &lodepng_default_decompress_settings);
+  } else {
+    error = lodepng_zlib_decompress(&data, &length, d, n,
+                                    &lodepng_default_decompress_settings);
+    // The zlib header is only two bytes: if the rest does not inflate, the
+    // file is taken to be text that happens to start like one.
+    if (error) {
+      free(data);
+      read_text(packed.data(), packed.data() + n, threads);
+      return;
+    }
+  }
+  unique_ptr<unsigned char, void (*)(void*)> owner(data, free);
+  if (error)
+    throw runtime_error(fmt::format("could not decompress {}: {}", filename,
+                                    lodepng_error_text(error)));
+  if (p != 0 and (read_le32(d + n - 4) != uint32_t(length) or
+                  read_le32(d + n - 8) != lodepng_crc32(data, length)))
+    throw runtime_error(fmt::format("gzip checksum mismatch in {}", filename));
+  vector<char>().swap(packed);
+
+  if (length >= sizeof(magic) and memcmp(data, magic, sizeof(magic)) == 0) {
+    read_binary(data, length);
+    storage.assign(cells, cells + size());
+    cells = storage.data();
+  } else {
+    const char* text = reinterpret_cast<const char*>(data);
+    read_text(text, text + length, threads);
+  }
+}
+
+void raster::read_png(const string& filename) {
+  vector<char> file = read_file(filename);
+  const unsigned char* d = reinterpret_cast<unsigned char*>(file.data());
+  lodepng::State state;
+  unsigned w, h;
+  vector<unsigned char> image;
+  unsigned error = lodepng_inspect(&w, &h, &state, d, file.size());
+  const unsigned depth = state.info_png.color.bitdepth == 16 ? 16 : 8;
+  if (not error) {
+    state.info_raw.colortype = LCT_RGBA;
+    state.info_raw.bitdepth = depth;
+    error = lodepng::decode(image, w, h, state, d, file.size());
+  }
+  if (error)
+    throw runtime_error(fmt::format("could not decode {}: {}", filename,
+                                    lodepng_error_text(error)));
+  vector<char>().swap(file);
+  if (ull(w) * h > ull(nl<int>::max()))
+    throw runtime_error(fmt::format("image {} is too large", filename));
+
+  // Channel ch (0 red, 1 green, 2 blue, 3 alpha) of pixel i; 16-bit samples
+  // are stored big-endian.
+  auto channel = [&](size_t i, int ch) {
+    if (depth == 8) return int(image[4 * i + ch]);
+    return image[8 * i + 2 * ch] << 8 | image[8 * i + 2 * ch + 1];
+  };
+
+  r_size = h;
+  c_size = w;
+  lots = -1;
+  num_apt_classes = 0;
+  river_pct = 0;
+  check_size();
+  storage.resize(size());
+  vector<bool> seen(1 << 16, false);
+  for (int i = 0; i < size(); ++i) {
+    int x = channel(i, 0);
+    if (channel(i, 3) == 0)
+      x = -2;
+    else if (channel(i, 1) != 0)
+      x = -1;
+    else if (channel(i, 2) != 0)
+      x = 0;
+    else if (x > nl<int16_t>::max())
+      throw runtime_error(fmt::format("cell value {} out of range", x));
+    else if (x > 0 and not seen[x]) {
+      seen[x] = true;
+      ++num_apt_classes;
+    }
+    storage[i] = x;
+  }
+  cells = storage.data();
+
+  for (size_t i = 0; i < state.info_png.text_num; ++i) {
+    string key = state.info_png.text_keys[i];
+    int* field = key == "lots" ? &lots
+                 : key == "num_apt_classes" ? &num_apt_classes
+                 : key == "river_pct" ? &river_pct
+                 : nullptr;
+    if (field == nullptr) continue;
+    try {
+      *field = stoi(state.info_png.text_strings[i]);
+    } catch (const logic_error&) {
+      throw runtime_error(fmt::format("invalid value '{}' for '{}' in {}",
+                                      state.info_png.text_strings[i], key,
+                                      filename));
+    }
+  }
+}
+
+ull raster::file_hash(const string& filename) {
+  vector<char> data = read_file(filename);
+  ull h = 14695981039346656037ull;
+  for (char c : data) h = (h ^ uchar(c)) * 1099511628211ull;
+  return h;
+}
+
+void raster::write_binary(const string& filename) const {
+  binary_header h;
+  memcpy(h.magic, magic, sizeof(magic));
+  h.r_size = r_size;
+  h.c_size = c_size;
+  h.lots = lots;
+  h.num_apt_classes = num_apt_classes;
+  h.river_pct = river_pct;
+
+  ofstream f(filename, ios::binary);
+  if (f.fail())
+    throw runtime_error(
+        fmt::format("could not open output file {}", filename));
+  f.write(reinterpret_cast<const char*>(&h), sizeof(h));
+  f.write(reinterpret_cast<const char*>(cells), size() * sizeof(int16_t));
+  if (f.fail())
+    throw runtime_error(fmt::format("could not write output file {}", filename));
+}
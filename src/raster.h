@@ -0,0 +1,101 @@
+/*
+* A genetic algorithm for fair land allocation
+* Copyright (c) 2017 Alex Gliesch, Marcus Ritt, Mayron C. O. Moreira
+*
+* Permission is hereby granted, free of charge, to any person (the "Person")
+* obtaining a copy of this software and associated documentation files (the
+* "Software"), to deal in the Software, including the rights to use, copy, modify,
+* merge, publish, distribute the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* 1. The above copyright notice and this permission notice shall be included in
+*    all copies or substantial portions of the Software.
+* 2. Under no circumstances shall the Person be permitted, allowed or authorized
+*    to commercially exploit the Software.
+* 3. Changes made to the original Software shall be labeled, demarcated or
+*    otherwise identified and attributed to the Person.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+* FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+* COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+* IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+* CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+#pragma once
+#include "defines.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// The raw contents of an instance file: the header and one value per cell, in
+// row-major order. Instances are read either from the text format
+//
+//   r_size c_size lots num_apt_classes river_pct
+//   <r_size * c_size cell values>
+//
+// or from the binary format written by write_binary(), which is memory-mapped
+// and read in place. The binary format is an 8-byte magic string, the five
+// header values as 32-bit integers and the cell values as 16-bit integers, all
+// in native byte order. Either format may also be gzip- or zlib-compressed; such
+// files are inflated in memory and parsed from the inflated buffer.
+//
+// Instances can also be read from PNG images of 8 or 16 bits per channel, one
+// pixel per cell. A transparent pixel (alpha 0) is outside the map (-2), a
+// pixel with a non-zero green channel is river (-1), one with a non-zero blue
+// channel is preserve (0), and otherwise the red channel is the aptitude value
+// of the cell (0 also meaning preserve). The header values are read from the
+// optional text chunks "lots", "num_apt_classes" and "river_pct"; by default
+// there are as many aptitude classes as distinct aptitude values, and the
+// number of lots is unknown (-1).
+struct raster {
+  raster() = default;
+  raster(const raster&) = delete;
+  raster& operator=(const raster&) = delete;
+  ~raster();
+
+  // Reads an instance file. Large text instances are parsed by up to threads
+  // threads.
+  void read(const string& filename, int threads = 1);
+
+  // Reads count whitespace-separated integers from a text file, as in a
+  // solution file.
+  static vi read_values(const string& filename, int count, int threads = 1);
+
+  void write_binary(const string& filename) const;
+
+  static bool is_binary(const string& filename);
+
+  static bool is_compressed(const string& filename);
+
+  static bool is_png(const string& filename);
+
+  int operator[](int i) const { return cells[i]; }
+
+  // 64-bit FNV-1a hash of the contents of a file.
+  static ull file_hash(const string& filename);
+
+  // Number of cells, computed in 64 bits: the readers check it against the
+  // range of an int, the type of cell indices, before sizing anything by it.
+  ll size() const { return ll(r_size) * c_size; }
+
+  int r_size = 0, c_size = 0, lots = -1, num_apt_classes = 0, river_pct = 0;
+
+private:
+  void check_size() const;
+
+  void read_text(const char* begin, const char* end, int threads);
+
+  void read_binary(const string& filename);
+
+  void read_binary(const void* data, size_t length);
+
+  void read_compressed(const string& filename, int threads);
+
+  void read_png(const string& filename);
+
+  const int16_t* cells = nullptr;
+  vector<int16_t> storage;
+  void* mapping = nullptr;
+  size_t mapping_size = 0;
+};
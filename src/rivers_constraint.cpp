@@ -31,12 +31,15 @@
 #include <iostream>
 #include <memory>
 
-void rivers_constraint::init() {
-  sa.resize(pt::lots);
-  index_sa.resize(pt::lots);
-  for (int i = 0; i < pt::lots; ++i) {
+void rivers_constraint::init(const instance& inst) {
+  this->inst = &inst;
+  sa.resize(inst.lots);
+  index_sa.resize(inst.lots);
+  for (int i = 0; i < inst.lots; ++i) {
     sa[i] = index_sa[i] = i;
   }
+  river_lots.assign(inst.lots + 1, 0);
+  river_area.assign(inst.lots + 1, 0);
   x = violations = value = 0;
 }
 
@@ -44,15 +47,14 @@ void rivers_constraint::compute_value_brute_force(int& nx, int& vio, int& cost,
                                                   const solution& s) const {
   nx = -1;
   cost = vio = 0;
-  for (int i = 0; i < pt::lots; ++i)
-    if (s.num_river[sa[i]] == 0) {
-      nx = sa[i];
-      break;
-    }
+  for (int i = 0; i < inst->lots; ++i) {
+    assert(sa[index_sa[i]] == i);
+    assert(i == 0 or s.area[sa[i - 1]] <= s.area[sa[i]]);
+    if (s.num_river[i] == 0 and (nx == -1 or s.area[i] < s.area[nx])) nx = i;
+  }
   if (nx == -1) return;
   assert(s.num_river[nx] == 0);
-  for (int i = 0; i < pt::lots; ++i) {
-    assert(sa[index_sa[i]] == i);
+  for (int i = 0; i < inst->lots; ++i) {
     if (s.num_river[i] > 0 and s.area[i] > s.area[nx]) {
       cost += s.area[i] - s.area[nx];
       ++vio;
@@ -61,212 +63,256 @@ void rivers_constraint::compute_value_brute_force(int& nx, int& vio, int& cost,
   assert(cost >= 0);
 }
 
-void rivers_constraint::calc_swap(int from, int to, int c, candidate& sp,
-                                  solution& s) {
-  sp.s1 = -1, sp.s2 = -1, sp.s3 = -1, sp.s4 = -1;
-  int cost = value, vio = violations, nx = x;
-  auto &area = s.area, &num_river = s.num_river;
-  assert(value != -1);
-
-  if (from != -1) {
-    assert(s.assigned[c] == from);
-    int i = index_sa[from], j;
-
-    for (j = i - 1; j >= 0; --j) {
-      if (area[sa[j]] < area[from]) break;
-      if (from == x and num_river[sa[j]] > 0) ++vio;
-    }
+void rivers_constraint::update(int p, int sign, const solution& s) {
+  int lot = sa[p];
+  if (s.num_river[lot] == 0) return;
+  for (int i = p + 1; i <= inst->lots; i += i & -i) {
+    river_lots[i] += sign;
+    river_area[i] += sign * s.area[lot];
+  }
+}
 
-    if (from == x) {
-      for (int j = i + 1; j < pt::lots; ++j) {
-        if (area[sa[j]] > area[from]) break;
-        if (num_river[sa[j]] > 0) {
-          ++vio;
-        }
-      }
-    }
+void rivers_constraint::swap_positions(int p, int q, const solution& s) {
+  if (p == q) return;
+  update(p, -1, s);
+  update(q, -1, s);
+  swap(sa[p], sa[q]);
+  index_sa[sa[p]] = p;
+  index_sa[sa[q]] = q;
+  update(p, +1, s);
+  update(q, +1, s);
+}
 
-#ifdef HARD_DEBUG
-    if (j >= 0) assert(area[sa[j]] < area[from]);
-    if (j != pt::lots - 1) assert(area[sa[j + 1]] == area[from]);
-#endif
+int rivers_constraint::upper(int a, const solution& s) const {
+  int lo = 0, hi = inst->lots;
+  while (lo < hi) {
+    int mid = (lo + hi) / 2;
+    if (s.area[sa[mid]] <= a)
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+  return lo;
+}
 
-    sp.s1 = i, sp.s2 = j + 1;
-    assert(sa[sp.s1] == from);
-    std::swap(sa[sp.s1], sa[sp.s2]);
-    index_sa[sa[sp.s1]] = sp.s1;
-    index_sa[sa[sp.s2]] = sp.s2;
-    if (pt::nx_river[c]) {
-      assert(num_river[from] > 0);
-      --num_river[from];
+int rivers_constraint::find_land(int k) const {
+  int p = 0, step = 1;
+  while (2 * step <= inst->lots) step *= 2;
+  for (; step > 0; step /= 2) {
+    if (p + step > inst->lots) continue;
+    int land = step - river_lots[p + step];
+    if (land < k) {
+      p += step;
+      k -= land;
     }
-    --area[from];
+  }
+  return p;
+}
 
-    if (num_river[from] == 0) {
-      assert(from != x or (from == nx and nx == x));
-      if (nx == -1 or area[from] < area[nx]) {
-        nx = from;
-      }
-      if (nx != x) {
-        assert(nx == from);
-        assert(x == -1 or index_sa[nx] < index_sa[x]);
-        int ax;
-        if (x != -1) {
-          ax = area[x];
-          if (area[nx] + 1 > ax) {
-            --vio;
-            cost -= (area[nx] + 1 - area[x]);
-          }
-          cost += (ax - area[nx]) * vio;
-        } else
-          ax = nl<int>::max();
-        for (j = index_sa[nx] + 1; j < pt::lots; ++j) {
-          if (area[sa[j]] > ax) break;
-          if (num_river[sa[j]] > 0 and area[sa[j]] > area[nx]) {
-            cost += area[sa[j]] - area[nx];
-            ++vio;
-          }
-        }
-      } else if (pt::nx_river[c] and x != -1) {
-        cost -= (area[from] + 1 - area[x]);
-        --vio;
-      } else if (from == x) {
-        cost += vio;
-      }
-    } else if (nx != -1) {
-      if (area[from] >= area[nx]) {
-        --cost;
-        if (area[from] == area[nx]) --vio;
-      }
-    }
+void rivers_constraint::river_above(int a, int& num, int& sum,
+                                    const solution& s) const {
+  num = sum = 0;
+  for (int i = inst->lots; i > 0; i -= i & -i) {
+    num += river_lots[i];
+    sum += river_area[i];
   }
+  for (int i = upper(a, s); i > 0; i -= i & -i) {
+    num -= river_lots[i];
+    sum -= river_area[i];
+  }
+}
 
-  if (to != -1) {
-    assert(s.assigned[c] != to);
-    int i = index_sa[to], j;
+void rivers_constraint::evaluate(int& nx, int& vio, int& cost,
+                                 const solution& s) const {
+  int p = find_land(1);
+  if (p == inst->lots) {
+    nx = -1;
+    vio = cost = 0;
+    return;
+  }
+  nx = sa[p];
+  int sum;
+  river_above(s.area[nx], vio, sum, s);
+  cost = sum - vio * s.area[nx];
+}
 
-    if (to == nx) {
-      for (j = i - 1; j >= 0 and area[sa[j]] == area[to]; --j) {
-        if (num_river[sa[j]] == 0) {
-          nx = sa[j];
-          break;
-        }
-      }
-    }
+void rivers_constraint::add_cell(int lot, int c, solution& s) {
+  // Move the lot to the end of its run of equal areas first, so that the
+  // order stays sorted when its area grows.
+  int p = index_sa[lot], q = upper(s.area[lot], s) - 1;
+  swap_positions(p, q, s);
+  update(q, -1, s);
+  ++s.area[lot];
+  if (inst->nx_river[c]) ++s.num_river[lot];
+  update(q, +1, s);
+}
 
-    for (j = i + 1; j < pt::lots; ++j) {
-      if (area[sa[j]] > area[to]) break;
-      if (to == nx) {
-        if (num_river[sa[j]] == 0) nx = sa[j];
-      }
-    }
+void rivers_constraint::remove_cell(int lot, int c, solution& s) {
+  int p = index_sa[lot], q = upper(s.area[lot] - 1, s);
+  swap_positions(p, q, s);
+  update(q, -1, s);
+  --s.area[lot];
+  if (inst->nx_river[c]) {
+    assert(s.num_river[lot] > 0);
+    --s.num_river[lot];
+  }
+  update(q, +1, s);
+}
 
-#ifdef HARD_DEBUG
-    if (j != pt::lots) assert(area[sa[j]] > area[to]);
-    if (j != 0) assert(area[sa[j - 1]] == area[to]);
-#endif
-    sp.s3 = i, sp.s4 = j - 1;
-    assert(sa[sp.s3] == to);
-    assert(index_sa[sa[j - 1]] == j - 1);
-    std::swap(sa[sp.s3], sa[sp.s4]);
-    index_sa[sa[sp.s3]] = sp.s3;
-    index_sa[sa[sp.s4]] = sp.s4;
-    if (pt::nx_river[c]) ++num_river[to];
-    ++area[to];
+void rivers_constraint::calc_swap(int from, int to, int c, candidate& sp,
+                                  solution& s) {
+  assert(value != -1);
+  if (from != -1) {
+    assert(s.assigned[c] == from);
+    remove_cell(from, c, s);
+    if (to != -1) add_cell(to, c, s);
+    int nx;
+    evaluate(nx, sp.vio, sp.value, s);
+    if (to != -1) remove_cell(to, c, s);
+    add_cell(from, c, s);
+    return;
+  }
 
-    if (nx != -1 and nx != to and area[nx] < area[to] and num_river[to] > 0) {
-      if (num_river[to] == 1 and pt::nx_river[c]) {
-        cost += area[to] - area[nx];
-        ++vio;
-      } else {
-        ++cost;
-        if (area[to] == area[nx] + 1) ++vio;
-      }
-    } else if (nx == to) {
-      if (num_river[to] > 0) {
-        nx = -1;
-        for (j = index_sa[to] + 1; j < pt::lots; ++j) {
-          if (nx != -1 and area[sa[j]] != area[nx]) {
-            assert(area[sa[j]] > area[nx]);
-            break;
-          }
-          if (num_river[sa[j]] == 0) {
-            if (nx == -1) nx = sa[j];
-          } else {
-            --vio;
-            cost -= area[sa[j]] - (area[to] - 1);
-          }
-        }
-        if (nx == -1) {
-          cost = vio = 0;
-        } else {
-          cost -= vio * (area[nx] - (area[to] - 1));
+  // Adding a cell to a lot changes the value only locally, unless the lot is
+  // the only smallest lot without river access; see the cases below.
+  assert(s.assigned[c] != to);
+  int cost = value, vio = violations;
+  const int a = s.area[to];
+  if (x != -1) {
+    const int a0 = s.area[x];
+    if (s.num_river[to] > 0) {
+      // A lot with access grows: it adds to the excess if it reaches a0.
+      if (a >= a0) ++cost;
+      if (a == a0) ++vio;
+    } else {
+      int second = find_land(2);
+      bool unique = a == a0 and (second == inst->lots or
+                                 s.area[sa[second]] > a0);
+      if (not unique) {
+        // The smallest area without access is unchanged.
+        if (inst->nx_river[c]) {
+          cost += a + 1 - a0;
+          ++vio;
         }
-      } else {
-        assert(not pt::nx_river[c]);
+      } else if (not inst->nx_river[c]) {
+        // The smallest lot without access grows by one: every violating lot
+        // exceeds it by one less, and those of area a0 + 1 stop violating.
+        int num1, sum1, num2, sum2;
+        river_above(a0, num1, sum1, s);
+        river_above(a0 + 1, num2, sum2, s);
         cost -= vio;
-        for (j = index_sa[nx] + 1; j < pt::lots; ++j) {
-          if (area[sa[j]] != area[nx]) break;
-          if (num_river[sa[j]] > 0) --vio;
-        }
+        vio -= num1 - num2;
+      } else if (second == inst->lots) {
+        // The last lot without access gains access.
+        cost = vio = 0;
+      } else {
+        // The next lot without access becomes the smallest; the growing lot
+        // has area a0 + 1, which is at most its area.
+        int a1 = s.area[sa[second]], sum;
+        river_above(a1, vio, sum, s);
+        cost = sum - vio * a1;
       }
     }
   }
-
-  if (nx == -1) {
-    assert(cost == 0);
-    assert(vio == 0);
-  }
+  sp.value = cost;
+  sp.vio = vio;
 
 #ifdef HARD_DEBUG
+  add_cell(to, c, s);
   int nx2, cost2, vio2;
   compute_value_brute_force(nx2, vio2, cost2, s);
   assert(cost == cost2);
   assert(vio == vio2);
+  remove_cell(to, c, s);
 #endif
+}
 
-  if (to != -1) {
-    assert(sp.s3 != -1 and sp.s4 != -1);
-    --area[to];
-    if (pt::nx_river[c]) --num_river[to];
-    swap(sa[sp.s3], sa[sp.s4]);
-    index_sa[sa[sp.s3]] = sp.s3;
-    index_sa[sa[sp.s4]] = sp.s4;
+// Applies the cells of a batch one by one if it is small compared to the
+// number of lots, and re-sorts all lots otherwise. The areas in s already
+// include the batch, so they are rolled back and replayed.
+void rivers_constraint::do_swaps(vector<::candidate>& cands, solution& s) {
+  if (cands.empty()) return;
+  if (4 * (int)cands.size() >= inst->lots) {
+    populate(s);
+    return;
   }
-  if (from != -1) {
-    assert(sp.s1 != -1 and sp.s2 != -1);
-    ++area[from];
-    if (pt::nx_river[c]) ++num_river[from];
-    swap(sa[sp.s1], sa[sp.s2]);
-    index_sa[sa[sp.s1]] = sp.s1;
-    index_sa[sa[sp.s2]] = sp.s2;
+  for (auto& c : cands) {
+    if (c.is_invalid()) continue;
+    --s.area[c.lot];
+    if (inst->nx_river[c.cell]) --s.num_river[c.lot];
   }
-  sp.value = cost;
-  sp.nx = nx;
-  sp.vio = vio;
+  for (auto& c : cands)
+    if (not c.is_invalid()) add_cell(c.lot, c.cell, s);
+  evaluate(x, violations, value, s);
+#ifdef HARD_DEBUG
+  assert(value == get_value_brute_force(s));
+#endif
 }
 
-void rivers_constraint::do_swaps(vector<::candidate>& cands,
-                                 const solution& s) {
-  if ((int)cands.size() > 0) populate(s);
+void rivers_constraint::do_moves(const viii& moves, solution& s) {
+  if (moves.empty()) return;
+  if (4 * (int)moves.size() >= inst->lots) {
+    populate(s);
+    return;
+  }
+  for (int i = (int)moves.size() - 1; i >= 0; --i) {
+    int c, from, to;
+    tie(c, from, to) = moves[i];
+    if (from == to) continue;
+    if (to != -1) {
+      --s.area[to];
+      if (inst->nx_river[c]) --s.num_river[to];
+    }
+    if (from != -1) {
+      ++s.area[from];
+      if (inst->nx_river[c]) ++s.num_river[from];
+    }
+  }
+  for (auto& m : moves) {
+    int c, from, to;
+    tie(c, from, to) = m;
+    if (from == to) continue;
+    if (from != -1) remove_cell(from, c, s);
+    if (to != -1) add_cell(to, c, s);
+  }
+  evaluate(x, violations, value, s);
+#ifdef HARD_DEBUG
+  assert(value == get_value_brute_force(s));
+#endif
 }
 
 void rivers_constraint::populate(const solution& s) {
   static vii areas;
-  areas.resize(pt::lots);
+  areas.resize(inst->lots);
 
-  for (int i = 0; i < pt::lots; ++i) {
+  for (int i = 0; i < inst->lots; ++i) {
     areas[i].ff = s.area[i];
     areas[i].ss = i;
   }
 
   sort(areas.begin(), areas.end());
-  sa.resize(pt::lots);
-  index_sa.resize(pt::lots);
+  sa.resize(inst->lots);
+  index_sa.resize(inst->lots);
 
-  for (int i = 0; i < pt::lots; ++i) {
+  river_lots.assign(inst->lots + 1, 0);
+  river_area.assign(inst->lots + 1, 0);
+  for (int i = 0; i < inst->lots; ++i) {
     sa[i] = areas[i].ss;
     index_sa[sa[i]] = i;
+    if (s.num_river[sa[i]] > 0) {
+      river_lots[i + 1] += 1;
+      river_area[i + 1] += s.area[sa[i]];
+    }
   }
-  compute_value_brute_force(s);
+  for (int i = 1; i <= inst->lots; ++i) {
+    int j = i + (i & -i);
+    if (j <= inst->lots) {
+      river_lots[j] += river_lots[i];
+      river_area[j] += river_area[i];
+    }
+  }
+  evaluate(x, violations, value, s);
+#ifdef HARD_DEBUG
+  assert(value == get_value_brute_force(s));
+#endif
 }
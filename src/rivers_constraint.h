@@ -28,7 +28,17 @@
 
 struct solution;
 struct candidate;
+struct instance;
 
+// The river constraint: no lot with access to a river may be larger than the
+// smallest lot without access. Its value is the total excess area of the lots
+// that violate it.
+//
+// sa holds the lots sorted by area (ties in any order) and index_sa the
+// position of each lot in sa. Two Fenwick trees over the positions of sa count
+// the lots with river access and sum their areas, so that the value for any
+// smallest area without access is found in O(log lots), and the order is kept
+// up to date in O(log lots) per assigned cell.
 struct rivers_constraint {
   rivers_constraint() = default;
   rivers_constraint(rivers_constraint&&) = default;
@@ -36,23 +46,22 @@ struct rivers_constraint {
   rivers_constraint& operator=(rivers_constraint&&) = default;
 
   struct candidate {
-    friend rivers_constraint;
     int vio = -1, value = -1;
-    int last_updated = -1;
     bool operator<(const candidate& sp) const { return value < sp.value; }
     bool operator==(const candidate& sp) const { return value == sp.value; }
-
-  private:
-    int nx = -1, s1 = -1, s2 = -1, s3 = -1, s4 = -1;
   };
 
-  void init();
+  void init(const instance& inst);
 
   void populate(const solution& s);
 
   void calc_swap(int from, int to, int c, candidate& sp, solution& s);
 
-  void do_swaps(vector<::candidate>& cands, const solution& s);
+  void do_swaps(vector<::candidate>& cands, solution& s);
+
+  // Same as do_swaps for a list of (cell, old lot, new lot) moves, where
+  // either lot may be -1.
+  void do_moves(const viii& moves, solution& s);
 
   int get_value_brute_force(const solution& s) const {
     int nx, vio, cost;
@@ -63,15 +72,39 @@ struct rivers_constraint {
   void compute_value_brute_force(int& nx, int& vio, int& cost,
                                  const solution& s) const;
 
-  void compute_value_brute_force(const solution& s) {
-    compute_value_brute_force(x, violations, value, s);
-  }
+  const instance* inst = nullptr;
 
-  int x;
+  int x = 0;
 
-  int violations;
+  int violations = 0;
 
-  int value;
+  int value = 0;
 
   vi sa, index_sa;
+
+private:
+  // Moves cell c into or out of lot, updating the area and river access of the
+  // lot in s together with the order and the trees.
+  void add_cell(int lot, int c, solution& s);
+
+  void remove_cell(int lot, int c, solution& s);
+
+  void swap_positions(int p, int q, const solution& s);
+
+  void update(int p, int sign, const solution& s);
+
+  // Computes x, violations and value from the trees.
+  void evaluate(int& nx, int& vio, int& cost, const solution& s) const;
+
+  // Number and total area of the lots with river access larger than a.
+  void river_above(int a, int& num, int& sum, const solution& s) const;
+
+  // First position in sa with area greater than a.
+  int upper(int a, const solution& s) const;
+
+  // Position in sa of the k-th lot without river access, or lots if there are
+  // fewer than k.
+  int find_land(int k) const;
+
+  vi river_lots, river_area;
 };
@@ -27,34 +27,60 @@
 #include "lodepng/lodepng.h"
 #include "parameters.h"
 #include "random.h"
+#include <algorithm>
 #include <cassert>
 #include <cmath>
 #include <iomanip>
 #include <iostream>
 
 void solution::init() {
-  area.assign(pt::lots, 0);
-  num_river.assign(pt::lots, 0);
-  assigned.assign(pt::nland, -1);
-  of.init();
-  rc.init();
+  assert(inst != nullptr);
+  area.assign(inst->lots, 0);
+  num_river.assign(inst->lots, 0);
+  assigned.assign(inst->nland, -1);
+  border_degree.assign(inst->nland, 0);
+  listed.assign(inst->nland, false);
+  border_list.clear();
+  num_border = 0;
+  if (prm::lot_lists) {
+    lot_head.assign(inst->lots, -1);
+    cell_next.assign(inst->nland, -1);
+    cell_prev.assign(inst->nland, -1);
+    lot_box.assign(inst->lots, box());
+  }
+  of.init(*inst);
+  rc.init(*inst);
   num_assigned = 0;
+  update_key();
 }
 
-void solution::populate(vi a) {
-  assert((int)a.size() == pt::nland);
+void solution::populate(const vlot& a) {
+  assert((int)a.size() == inst->nland);
   init();
-  swap(a, assigned);
-  for (int i = 0; i < pt::nland; ++i) {
+  assigned = a;
+  for (int i = 0; i < inst->nland; ++i) {
     int lot = assigned[i];
     if (lot != -1) {
       ++num_assigned;
       ++area[lot];
-      if (pt::nx_river[i]) ++num_river[lot];
+      if (inst->nx_river[i]) ++num_river[lot];
+    }
+    int d = 0;
+    for (auto nb : inst->neighbours[i])
+      if (assigned[nb] != lot) ++d;
+    border_degree[i] = d;
+    if (d > 0) {
+      ++num_border;
+      listed[i] = true;
+      border_list.push_back(i);
     }
   }
+  if (prm::lot_lists)
+    for (int i = inst->nland - 1; i >= 0; --i)
+      if (assigned[i] != -1) link(i, assigned[i]);
   rc.populate(*this);
   of.populate(*this);
+  update_key();
 }
 
 int solution::do_swaps(vector<candidate>& cands) {
@@ -65,19 +91,132 @@ int solution::do_swaps(vector<candidate>& cands) {
       continue;
     }
     assert(assigned[c.cell] == -1);
-    assigned[c.cell] = c.lot;
+    assign(c.cell, c.lot);
     ++num_assigned;
     ++area[c.lot];
-    if (pt::nx_river[c.cell]) ++num_river[c.lot];
+    if (inst->nx_river[c.cell]) ++num_river[c.lot];
     ++done;
   }
   rc.do_swaps(cands, *this);
   of.do_swaps(cands);
+  update_key();
   return done;
 }
 
+// Undoes the logged changes in assigned, so that it matches the rest of the
+// solution again, and replays them one by one.
+void solution::apply_changes(viii& log) {
+  for (int i = (int)log.size() - 1; i >= 0; --i)
+    assigned[get<0>(log[i])] = get<1>(log[i]);
+  for (auto& m : log) {
+    int c, from, to;
+    tie(c, from, to) = m;
+    assert(assigned[c] == from);
+    if (from == to) continue;
+    assign(c, to);
+    if (from != -1) {
+      --area[from];
+      if (inst->nx_river[c]) --num_river[from];
+      --num_assigned;
+    }
+    if (to != -1) {
+      ++area[to];
+      if (inst->nx_river[c]) ++num_river[to];
+      ++num_assigned;
+    }
+  }
+  rc.do_moves(log, *this);
+  of.do_moves(log);
+  log.clear();
+  update_key();
+}
+
+// Moves cell c to lot, updating the border degrees of c and its neighbours.
+void solution::assign(int c, int lot) {
+  int from = assigned[c], d = border_degree[c];
+  for (auto nb : inst->neighbours[c]) {
+    int l = assigned[nb], delta = (l != lot) - (l != from);
+    if (delta == 0) continue;
+    d += delta;
+    uchar& e = border_degree[nb];
+    if (e == 0) {
+      ++num_border;
+      if (not listed[nb]) {
+        listed[nb] = true;
+        border_list.push_back(nb);
+      }
+    }
+    e += delta;
+    if (e == 0) --num_border;
+  }
+  if (border_degree[c] == 0 and d > 0) {
+    ++num_border;
+    if (not listed[c]) {
+      listed[c] = true;
+      border_list.push_back(c);
+    }
+  } else if (border_degree[c] > 0 and d == 0)
+    --num_border;
+  border_degree[c] = d;
+  if (not lot_head.empty()) {
+    if (from != -1) unlink(c, from);
+    if (lot != -1) link(c, lot);
+  }
+  assigned[c] = lot;
+  if ((int)border_list.size() > 2 * num_border + 64) compact_border();
+}
+
+void solution::compact_border() {
+  int j = 0;
+  for (int c : border_list)
+    if (border_degree[c] > 0)
+      border_list[j++] = c;
+    else
+      listed[c] = false;
+  border_list.resize(j);
+  assert(j == num_border);
+}
+
+void solution::link(int c, int lot) {
+  cell_prev[c] = -1;
+  cell_next[c] = lot_head[lot];
+  if (lot_head[lot] != -1) cell_prev[lot_head[lot]] = c;
+  lot_head[lot] = c;
+  int r, col;
+  tie(r, col) = inst->rc_from_index[c];
+  box& b = lot_box[lot];
+  b.r0 = min(b.r0, r), b.r1 = max(b.r1, r);
+  b.c0 = min(b.c0, col), b.c1 = max(b.c1, col);
+}
+
+void solution::unlink(int c, int lot) {
+  if (cell_prev[c] != -1)
+    cell_next[cell_prev[c]] = cell_next[c];
+  else
+    lot_head[lot] = cell_next[c];
+  if (cell_next[c] != -1) cell_prev[cell_next[c]] = cell_prev[c];
+  int r, col;
+  tie(r, col) = inst->rc_from_index[c];
+  box& b = lot_box[lot];
+  if (r == b.r0 or r == b.r1 or col == b.c0 or col == b.c1) {
+    b = box();
+    for_each_cell(lot, [&](int o) {
+      int r, col;
+      tie(r, col) = inst->rc_from_index[o];
+      b.r0 = min(b.r0, r), b.r1 = max(b.r1, r);
+      b.c0 = min(b.c0, col), b.c1 = max(b.c1, col);
+    });
+  }
+}
+
+const vi& solution::border() {
+  compact_border();
+  sort(border_list.begin(), border_list.end());
+  return border_list;
+}
+
 bool solution::check_border_brute_force(int c) const {
-  for (auto nb : pt::neighbours[c])
+  for (auto nb : inst->neighbours[c])
     if (assigned[nb] != assigned[c]) return true;
   return false;
 }
@@ -106,38 +245,51 @@ double solution::size_ratio() const {
   return sr > prm::maximum_size_ratio ? sr : 0;
 }
 
+fitness_key solution::compute_key() const {
+  ull ratio = 0;
+  int sa = area[small_lot()], ba = area[big_lot()];
+  if (sa == 0)
+    ratio = nl<uint32_t>::max();
+  else if (ba > (ll)prm::maximum_size_ratio * sa)
+    ratio = min<ull>(ll(ba) * 1000 / sa, nl<uint32_t>::max() - 1);
+  assert(rc.value >= 0 and of.value >= 0);
+  return fitness_key(rc.value) << 96 | fitness_key(ratio) << 64 |
+         ull(of.value);
+}
+
 void solution::write_to_png(const string& filename) const {
-  static vbyte rcolor(pt::lots), gcolor(pt::lots), bcolor(pt::lots);
-  static bool colors_chosen = false;
+  static vbyte rcolor, gcolor, bcolor;
   const double golden_ratio_conjugate = 0.618033988749895;
-  if (not colors_chosen) {
+  if ((int)rcolor.size() != inst->lots) {
+    rcolor.resize(inst->lots);
+    gcolor.resize(inst->lots);
+    bcolor.resize(inst->lots);
     double h = rng.rand_double(0.0, 1.0), intpart;
-    for (int i = 0; i < pt::lots; ++i) {
+    for (int i = 0; i < inst->lots; ++i) {
       h += golden_ratio_conjugate;
       h = modf(h, &intpart);
       hsv_to_rgb(h * 255, 125, 240, rcolor[i], gcolor[i], bcolor[i]);
     }
-    colors_chosen = true;
   }
 
-  vbyte data(pt::r_size * pt::c_size * 4);
+  const int width = inst->raster_c_size, height = inst->raster_r_size;
+  vbyte data(width * height * 4, 0);
+  for (int i = 3; i < (int)data.size(); i += 4)
+    data[i] = 255;
   auto set_color = [&](int r, int c, int red, int green, int blue) {
-    data[4 * (r * pt::c_size + c) + 0] = red;
-    data[4 * (r * pt::c_size + c) + 1] = green;
-    data[4 * (r * pt::c_size + c) + 2] = blue;
-    data[4 * (r * pt::c_size + c) + 3] = 255;
+    int o = 4 * ((r + inst->r_origin) * width + c + inst->c_origin);
+    data[o + 0] = red;
+    data[o + 1] = green;
+    data[o + 2] = blue;
   };
 
-  for (int r = 0; r < pt::r_size; ++r)
-    for (int c = 0; c < pt::c_size; ++c) {
-      if (pt::cell_type[r][c] == pt::river) {
+  for (int r = 0; r < inst->r_size; ++r)
+    for (int c = 0; c < inst->c_size; ++c) {
+      auto type = inst->type_at(r, c);
+      if (type == instance::river) {
         set_color(r, c, 0, 0, 255);
-      } else if (pt::in_cell[r * pt::c_size + c] == -2) {
-        set_color(r, c, 0, 0, 0);
-      } else if (pt::cell_type[r][c] == pt::preserve) {
-        set_color(r, c, 0, 0, 0);
-      } else {
-        int i = pt::index_from_rc[r][c];
+      } else if (type == instance::land) {
+        int i = inst->index_at(r, c);
         if (not is_assigned(i)) {
           set_color(r, c, 255, 255, 255);
         } else {
@@ -147,7 +299,7 @@ void solution::write_to_png(const string& filename) const {
       }
     }
   vbyte png;
-  uint error = lodepng::encode(png, data, pt::c_size, pt::r_size);
+  uint error = lodepng::encode(png, data, width, height);
   if (error) {
     fmt::print("lodepng error: %s\n", lodepng_error_text(error));
     exit(EXIT_FAILURE);
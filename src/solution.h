@@ -36,8 +36,16 @@
 
 struct candidate;
 
+// The fitness of a solution as one integer, ordered like the solutions: the
+// river constraint value in the top 32 bits, then the size ratio in thousandths
+// (0 if within the limit) in the next 32 bits, then the objective value in the
+// low 64 bits. The objective value alone can need more than 32 bits, so the
+// key does not fit in 64 bits.
+__extension__ typedef unsigned __int128 fitness_key;
+
 struct solution {
 	solution() = default;
+	explicit solution(const instance &inst) : inst(&inst) {}
 	solution(const solution &) = default;
 	solution(solution &&) = default;
 	solution &operator=(const solution &) = default;
@@ -45,25 +53,37 @@ struct solution {
 
 	void init();
 
-	void populate(vi assigned);
+	void populate(const vlot &assigned);
 
 	bool is_assigned(int c) const { return assigned[c] != -1; }
 
 	void write_to_png(const string &filename) const;
 
 	bool operator<(const solution &s) const {
-		int r = river_value() - s.river_value();
-		if (r == 0) {
-			double sr = size_ratio() - s.size_ratio();
-			if (eps_eq(sr, 0.0))
-				return value() < s.value();
-			return sr < 0;
-		}
-		return r < 0;
+#ifdef HARD_DEBUG
+		assert(key == compute_key() and s.key == s.compute_key());
+#endif
+		return key < s.key;
 	}
 
+	// Recomputes key; called whenever the solution changes.
+	void update_key() { key = compute_key(); }
+
+	fitness_key compute_key() const;
+
 	int do_swaps(vector<candidate> &candidates);
 
+	// Moves cell c to lot (or unassigns it if lot is -1) in assigned only, and
+	// logs the change as (cell, old lot, new lot) in the caller's log.
+	// apply_changes(log) brings the rest of the solution up to date, in time
+	// proportional to the number of changes and of lots, and clears the log.
+	void reassign(viii& log, int c, int lot) {
+		log.emplace_back(c, assigned[c], lot);
+		assigned[c] = lot;
+	}
+
+	void apply_changes(viii& log);
+
 	ll value() const;
 
 	int river_value() const;
@@ -79,22 +99,71 @@ struct solution {
 
 	inline int big_lot() const {
 #ifdef HARD_DEBUG
-		assert(area[rc.sa[pt::lots - 1]] == max(area));
+		assert(area[rc.sa[inst->lots - 1]] == max(area));
 #endif
-		return rc.sa[pt::lots - 1];
+		return rc.sa[inst->lots - 1];
 	}
 
 	double size_ratio() const;
 
 	vi num_river;
 
-	vi assigned;
+	vlot assigned;
 
 	int num_assigned = 0;
 
 	bool check_border_brute_force(int c) const;
 
+	// True if some neighbour of c is in another lot or unassigned.
+	bool is_border(int c) const { return border_degree[c] > 0; }
+
+	// The border cells in increasing order.
+	const vi &border();
+
+	// Number of neighbours of each cell that are not in its lot.
+	vbyte border_degree;
+
+	int num_border = 0;
+
+	// Calls f on every cell of lot, in no particular order. With --lot-lists
+	// this takes time proportional to the area of the lot.
+	template <typename F>
+	void for_each_cell(int lot, F f) const {
+		if (lot_head.empty()) {
+			for (int c = 0; c < inst->nland; ++c)
+				if (assigned[c] == lot) f(c);
+		} else
+			for (int c = lot_head[lot]; c != -1; c = cell_next[c]) f(c);
+	}
+
+	// Smallest rectangle of rows [r0, r1] and columns [c0, c1] containing a lot.
+	struct box {
+		int r0 = nl<int>::max(), c0 = nl<int>::max(), r1 = -1, c1 = -1;
+	};
+
+	// Requires --lot-lists.
+	const box &bounding_box(int lot) const { return lot_box[lot]; }
+
+	const instance *inst = nullptr;
+
 	objective_function of;
 
 	rivers_constraint rc;
+
+	fitness_key key = ~fitness_key(0);
+
+private:
+	void assign(int c, int lot);
+	void compact_border();
+	void link(int c, int lot);
+	void unlink(int c, int lot);
+
+	// Per-lot intrusive doubly linked lists of cells; empty without --lot-lists.
+	vi lot_head, cell_next, cell_prev;
+	vector<box> lot_box;
+
+	// Every border cell, plus cells that have left the border since the last
+	// compaction; listed[c] marks the cells in the list.
+	vi border_list;
+	vb listed;
 };
\ No newline at end of file
@@ -23,15 +23,17 @@
 * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 */
 #include "statistics.h"
-#include "initial_positions.h"
 #include "parameters.h"
 #include "proterra.h"
 #include "solution.h"
 #include "util.h"
 #include "validate.h"
+#include <cstdlib>
 #include <fstream>
 #include <iostream>
+#include <new>
 
+const instance* stats::inst = nullptr;
 timer<> stats::time;
 solution stats::global_best;
 vi stats::river_violations, stats::river_values;
@@ -39,7 +41,23 @@ vd stats::size_ratios, stats::values, stats::cum_times, stats::times;
 int stats::nrepl = 0, stats::num_mutations = 0, stats::num_crossovers = 0,
     stats::num_disconnected_crossover_lots = 0,
     stats::num_empty_crossover_lots = 0, stats::num_new_solutions = 0,
-    stats::num_generations = 0;
+    stats::num_generations = 0, stats::max_frontier = 0;
+ll stats::frontier_sum = 0, stats::num_construction_steps = 0;
+
+#ifdef HARD_DEBUG
+atomic<ll> stats::num_allocations{0};
+
+void* operator new(size_t n) {
+  ++stats::num_allocations;
+  void* p = malloc(n ? n : 1);
+  if (p == nullptr) throw bad_alloc();
+  return p;
+}
+
+void operator delete(void* p) noexcept { free(p); }
+
+void operator delete(void* p, size_t) noexcept { free(p); }
+#endif
 
 template <typename T>
 void pr_min_avg_max(const T& v, const string& name, int best, int worst) {
@@ -47,7 +65,25 @@ void pr_min_avg_max(const T& v, const string& name, int best, int worst) {
      (double)avg(v), (double)v[worst]);
 }
 
+void stats::init(const instance& inst) {
+  // The clock is not restarted: it runs from the start of the program, so
+  // --time and the reported times include reading the instance.
+  stats::inst = &inst;
+  global_best = solution();
+  river_violations.clear();
+  river_values.clear();
+  size_ratios.clear();
+  values.clear();
+  cum_times.clear();
+  times.clear();
+  nrepl = num_mutations = num_crossovers = num_disconnected_crossover_lots =
+      num_empty_crossover_lots = num_new_solutions = num_generations =
+          max_frontier = 0;
+  frontier_sum = num_construction_steps = 0;
+}
+
 void stats::write_stats() {
+  if (inst == nullptr) return;
   if (global_best.num_assigned != 0 and nrepl == 0) add_stats(global_best);
 
   viii obj;
@@ -57,11 +93,14 @@ void stats::write_stats() {
 
   pr("FINISHED, printing statistics...\n\n", nrepl);
   pr("--instance {}\n", prm::instance_name.c_str());
-  pr("--nland {}\n", pt::nland);
-  pr("--lots {}\n", pt::lots);
+  pr("--nland {}\n", inst->nland);
+  pr("--lots {}\n", inst->lots);
   pr("--batch-size {}\n", prm::batch_size);
   pr("--time {:.2f}\n", time.seconds());
   pr("--repl {}\n", nrepl);
+  pr("--frontier max {} avg {:.1f}\n", max_frontier,
+     num_construction_steps ? frontier_sum / (double)num_construction_steps
+                            : 0.0);
   pr_min_avg_max(values, "value", best, worst);
   pr_min_avg_max(river_violations, "river_violations", best, worst);
   pr_min_avg_max(river_values, "river_value", best, worst);
@@ -83,14 +122,15 @@ void stats::write_stats() {
   if (prm::naive) num_generations = nrepl;
 
   fmt::print("{} ", prm::instance_name);
-  fmt::print("{} ", pt::c_size);
-  fmt::print("{} ", pt::r_size);
-  fmt::print("{} ", pt::lots);
-  fmt::print("{} ", pt::nland);
-  fmt::print("{} ", pt::nriver);
-  fmt::print("{} ", pt::r_size * pt::c_size - pt::nriver - pt::nland);
-  fmt::print("{} ", pt::num_apt_classes);
-  fmt::print("{} ", initial_positions::cc.size());
+  fmt::print("{} ", inst->raster_c_size);
+  fmt::print("{} ", inst->raster_r_size);
+  fmt::print("{} ", inst->lots);
+  fmt::print("{} ", inst->nland);
+  fmt::print("{} ", inst->nriver);
+  fmt::print("{} ", inst->raster_r_size * inst->raster_c_size - inst->nriver -
+                       inst->nland);
+  fmt::print("{} ", inst->num_apt_classes);
+  fmt::print("{} ", inst->cc.size());
   fmt::print("{} ", prm::batch_size);
   fmt::print("{} ", prm::crossover_ratio);
   fmt::print("{} ", prm::keep_ratio);
@@ -180,15 +220,27 @@ void stats::add_stats(const solution& s) {
   validate_solution(s);
   int i = nrepl++;
   assert(abs(s.of.value - (ll)s.of.compute_value_brute_force()) < 2);
-  values.push_back(sqrt(s.of.value / (double)pt::lots));
+#ifdef HARD_DEBUG
+  const ll allocations = num_allocations;
+#endif
+  values.push_back(sqrt(s.of.value / (double)inst->lots));
   river_violations.push_back(s.rc.violations);
   river_values.push_back(s.rc.value);
   int ba = max(s.area), sa = min(s.area);
   size_ratios.push_back(sa ? (double)ba / (double)sa : 0);
   cum_times.push_back(time.seconds());
   times.push_back(i ? time.seconds() - cum_times[i - 1] : time.seconds());
+#ifdef HARD_DEBUG
+  // The history grows with the run and is not counted.
+  num_allocations = allocations;
+#endif
   pr("value {:.2f}\nrivers {}\nsize_ratio {:.2f}\n\ntime {:.2f}\n", values[i],
      river_values[i], size_ratios[i], cum_times[i]);
+#ifdef HARD_DEBUG
+  static ll last_allocations = 0;
+  pr("allocations {}\n", num_allocations - last_allocations);
+  last_allocations = num_allocations;
+#endif
   pr("\n");
 
   if (global_best.num_assigned == 0 or s < global_best) global_best = s;
@@ -27,17 +27,20 @@
 #include "parameters.h"
 #include "solution.h"
 #include "timer.h"
+#include <atomic>
 #include <string>
 #include <vector>
 
 struct solution;
 
 struct stats {
+  static void init(const instance& inst);
   static void write_stats();
   static void add_stats(const solution& ds);
   inline static bool time_limit_exceeded() {
     return time.seconds() >= prm::time_limit_seconds;
   }
+  static const instance* inst;
   static timer<> time;
   static solution global_best;
   static int num_generations;
@@ -47,9 +50,19 @@ struct stats {
   static int num_crossovers;
   static int num_mutations;
   static int nrepl;
+  // Largest frontier of the constructive, and the sum of its sizes over all
+  // construction steps.
+  static int max_frontier;
+  static ll frontier_sum, num_construction_steps;
   static vd values;
   static vi river_violations;
   static vi river_values;
   static vd size_ratios;
   static vd times, cum_times;
+#ifdef HARD_DEBUG
+  // Heap allocations so far, from any thread; generations after the first few
+  // should reuse the storage of the solutions and of the static work arrays,
+  // and allocate only when one of them grows past its high-water mark.
+  static atomic<ll> num_allocations;
+#endif
 };
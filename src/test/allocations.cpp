@@ -0,0 +1,90 @@
+/*
+* A genetic algorithm for fair land allocation
+* Copyright (c) 2017 Alex Gliesch, Marcus Ritt, Mayron C. O. Moreira
+*
+* Permission is hereby granted, free of charge, to any person (the "Person")
+* obtaining a copy of this software and associated documentation files (the
+* "Software"), to deal in the Software, including the rights to use, copy, modify,
+* merge, publish, distribute the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* 1. The above copyright notice and this permission notice shall be included in
+*    all copies or substantial portions of the Software.
+* 2. Under no circumstances shall the Person be permitted, allowed or authorized
+*    to commercially exploit the Software.
+* 3. Changes made to the original Software shall be labeled, demarcated or
+*    otherwise identified and attributed to the Person.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+* FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+* COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+* IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+* CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+// Checks that the generations of the genetic algorithm reuse their storage. The
+// work arrays and the solutions keep their buffers, so after a warm-up a
+// generation allocates only when a buffer grows past its high-water mark, which
+// happens a few times in a run. The check fails on a generation with at least as
+// many allocations as constructions, as one allocation in every crossover,
+// mutation or new solution would give. Generations whose population was rebuilt by a restart are not
+// checked. Built with HARD_DEBUG, which counts the allocations, and run by
+// `make check`.
+#include "../ga.h"
+#include "../parameters.h"
+#include "../proterra.h"
+#include "../statistics.h"
+#include "../util.h"
+
+#ifndef HARD_DEBUG
+#error "the allocation counter needs HARD_DEBUG; build with 'make check'"
+#endif
+
+namespace {
+// Generations that may still allocate while the arrays grow.
+const int warm_up = 10;
+} // namespace
+
+int main(int argc, char** argv) {
+  prm::random_seed = 1;
+  prm::max_generations = 40;
+  prm::restart = 15;
+  prm::parse_cmd_line(argc, argv);
+  try {
+    instance inst(prm::input_filename);
+    stats::init(inst);
+    ga g(inst);
+    auto constructions = [] {
+      return stats::num_crossovers + stats::num_mutations +
+             stats::num_new_solutions;
+    };
+    ll last = stats::num_allocations, total = 0;
+    int last_constructions = constructions(), checked = 0, failed = 0;
+    g.on_generation = [&](bool restarted) {
+      ll n = stats::num_allocations - last;
+      int k = constructions() - last_constructions;
+      last = stats::num_allocations;
+      last_constructions = constructions();
+      if (stats::num_generations < warm_up or restarted) return;
+      ++checked;
+      total += n;
+      if (n >= k) {
+        pr("generation {}: {} allocations in {} constructions\n",
+           stats::num_generations, n, k);
+        ++failed;
+      }
+    };
+    g.run();
+    pr("{} allocations in {} checked generations\n", total, checked);
+    if (failed) {
+      pr("FAILED: {} generations allocated once per construction\n", failed);
+      return EXIT_FAILURE;
+    }
+    pr("passed\n");
+  } catch (std::exception& e) {
+    pr("\nexception: {}\n", e.what());
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}
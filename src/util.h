@@ -95,6 +95,90 @@ void pr_vec(const string& intro, const vector<T>& v, const string& sep) {
 		pr("\n");
 }
 
+// A queue of ints for breadth-first searches, backed by a vector that is
+// reset when the queue runs empty. Unlike std::queue, it stops allocating once
+// it has reached the largest size a search needs.
+struct fifo {
+	void push(int x) { v.push_back(x); }
+	int front() const { return v[head]; }
+	void pop() {
+		if (++head == v.size())
+			v.clear(), head = 0;
+	}
+	size_t size() const { return v.size() - head; }
+	bool empty() const { return size() == 0; }
+	void clear() { v.clear(), head = 0; }
+
+	vi v;
+	size_t head = 0;
+};
+
+// Many queues of ints that share one pool of entries, with a free list. Their
+// storage is bounded by the number of entries queued at any one time, while a
+// separate fifo per queue keeps growing until that queue runs empty.
+struct fifo_pool {
+	struct entry {
+		int x, next;
+	};
+	struct list {
+		int head = -1, tail = -1;
+		size_t size = 0;
+	};
+
+	// The queue at index i of the pool; valid until the next reset.
+	struct ref {
+		void push(int x) {
+			int e = p.free;
+			if (e == -1) {
+				e = p.entries.size();
+				p.entries.push_back({x, -1});
+			} else {
+				p.free = p.entries[e].next;
+				p.entries[e] = {x, -1};
+			}
+			if (l.tail == -1)
+				l.head = e;
+			else
+				p.entries[l.tail].next = e;
+			l.tail = e;
+			++l.size;
+		}
+		int front() const { return p.entries[l.head].x; }
+		void pop() {
+			int e = l.head;
+			l.head = p.entries[e].next;
+			if (l.head == -1) l.tail = -1;
+			p.entries[e].next = p.free;
+			p.free = e;
+			--l.size;
+		}
+		size_t size() const { return l.size; }
+		bool empty() const { return l.size == 0; }
+		void clear() {
+			if (l.head == -1) return;
+			p.entries[l.tail].next = p.free;
+			p.free = l.head;
+			l = list();
+		}
+
+		fifo_pool& p;
+		list& l;
+	};
+
+	ref operator[](int i) { return {*this, lists[i]}; }
+	size_t size() const { return lists.size(); }
+	// Makes n empty queues.
+	void reset(int n) {
+		lists.assign(n, list());
+		entries.clear();
+		free = -1;
+	}
+
+	vector<list> lists;
+	vector<entry> entries;
+	int free = -1;
+};
+
 // credits to http://web.mit.edu/storborg/Public/hsvtorgb.c
 inline void hsv_to_rgb(uchar h, uchar s, uchar v, uchar& r, uchar& g, uchar& b) {
 	uchar region, fpart, p, q, t;
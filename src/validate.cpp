@@ -23,45 +23,42 @@
 * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 */
 #include "validate.h"
+#include "parameters.h"
 #include "proterra.h"
 #include "random.h"
 #include "util.h"
 #include <algorithm>
 #include <cassert>
-#include <queue>
 
 void validate_solution(const solution& s) {
   (void)s;
 #ifdef HARD_DEBUG
-  static vi any_cell, area, vis, river, border_size;
-  static vvi borders;
+  const instance& inst = *s.inst;
+  static vi any_cell, area, vis, river;
   int numAssigned = 0;
-  any_cell.assign(pt::lots, -1);
-  area.assign(pt::lots, 0);
-  river.assign(pt::lots, 0);
-  borders.assign(pt::lots, vi());
-  vis.assign(pt::nland, 0);
+  any_cell.assign(inst.lots, -1);
+  area.assign(inst.lots, 0);
+  river.assign(inst.lots, 0);
+  vis.assign(inst.nland, 0);
 
-  for (int i = 0; i < pt::nland; ++i) {
+  for (int i = 0; i < inst.nland; ++i) {
     if (s.assigned[i] != -1) {
       ++numAssigned;
       ++area[s.assigned[i]];
       if (rng.rand_double(0.0, 1.0) < 1.0 / double(area[s.assigned[i]]))
         any_cell[s.assigned[i]] = i;
-      if (pt::nx_river[i]) ++river[s.assigned[i]];
-      if (s.check_border_brute_force(i)) {
-        borders[s.assigned[i]].push_back(i);
-      }
+      if (inst.nx_river[i]) ++river[s.assigned[i]];
+      assert(s.is_border(i) == s.check_border_brute_force(i));
     }
   }
 
   int vis_total = 0;
-  for (int i = 0; i < pt::lots; ++i) {
+  for (int i = 0; i < inst.lots; ++i) {
     assert(area[i] > 0);
     assert(area[i] == s.area[i]);
     assert(any_cell[i] != -1);
     assert(s.assigned[any_cell[i]] == i);
-    queue<int> q;
+    static fifo q;
     q.push(any_cell[i]);
     vis[any_cell[i]] = 1;
     int visLot = 0;
@@ -69,7 +66,7 @@ void validate_solution(const solution& s) {
       int c = q.front();
       q.pop();
       ++visLot;
-      for (int nb : pt::neighbours[c])
+      for (int nb : inst.neighbours[c])
         if (s.assigned[nb] == s.assigned[c] and vis[nb] == 0) {
           assert(s.assigned[nb] == i);
           vis[nb] = 1;
@@ -82,10 +79,29 @@ void validate_solution(const solution& s) {
     }
     vis_total += visLot;
   }
-  assert(pt::nland == numAssigned);
+  assert(inst.nland == numAssigned);
   assert(vis_total == numAssigned);
   assert(s.num_assigned == numAssigned);
   s.of.assert_value_acceptable();
   assert(s.rc.value == s.rc.get_value_brute_force(s));
+
+  if (prm::lot_lists) {
+    for (int i = 0; i < inst.lots; ++i) {
+      int n = 0;
+      solution::box b;
+      s.for_each_cell(i, [&](int c) {
+        assert(s.assigned[c] == i);
+        ++n;
+        b.r0 = min(b.r0, inst.rc_from_index[c].ff);
+        b.r1 = max(b.r1, inst.rc_from_index[c].ff);
+        b.c0 = min(b.c0, inst.rc_from_index[c].ss);
+        b.c1 = max(b.c1, inst.rc_from_index[c].ss);
+      });
+      assert(n == area[i]);
+      const solution::box& sb = s.bounding_box(i);
+      assert(sb.r0 == b.r0 and sb.r1 == b.r1 and sb.c0 == b.c0 and
+             sb.c1 == b.c1);
+    }
+  }
 #endif
 }
@@ -33,16 +33,16 @@
 #include <ciso646>
 #include <iostream>
 
-vi voronoi::construct(const vi& pos) {
-  vi assigned(pt::nland, -1);
-  vi dist(pt::nland, -1);
-  vector<boost::heap::fibonacci_heap<iii>::handle_type> handle(pt::nland);
+vi voronoi::construct(const instance& inst, const vi& pos) {
+  vi assigned(inst.nland, -1);
+  vi dist(inst.nland, -1);
+  vector<boost::heap::fibonacci_heap<iii>::handle_type> handle(inst.nland);
   boost::heap::fibonacci_heap<iii> pq;
 
-  assert((int)pos.size() == pt::lots);
-  for (int i = 0; i < pt::lots; ++i) {
+  assert((int)pos.size() == inst.lots);
+  for (int i = 0; i < inst.lots; ++i) {
     int c = pos[i];
-    dist[c] = pt::val[c];
+    dist[c] = inst.val[c];
     handle[c] = pq.push(iii(-dist[c], c, i));
   }
 
@@ -55,8 +55,8 @@ vi voronoi::construct(const vi& pos) {
     assigned[c] = p;
     ++num_expansions;
 
-    for (auto nb : pt::neighbours[c]) {
-      int cd = d + pt::val[nb];
+    for (auto nb : inst.neighbours[c]) {
+      int cd = d + inst.val[nb];
       if (dist[nb] == -1) {
         handle[nb] = pq.push(iii(-cd, nb, p));
         dist[nb] = cd;
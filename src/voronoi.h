@@ -27,5 +27,5 @@
 #include "solution.h"
 
 struct voronoi {
-  static vi construct(const vi& pos);
+  static vi construct(const instance& inst, const vi& pos);
 };